@@ -1,94 +1,89 @@
 // See end of file for test cases
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
-#include <curses.h> // to clear the screen
+#include <unistd.h> // isatty
+#include "ms_engine.h"
+#include "ms_solver.h"
+#include "ms_endless.h"
+#include "ms_render.h"
+#include "ms_viewport.h"
+#include "ms_save.h"
+#include "ms_journal.h"
+#include "ms_server.h"
+#include "ms_simulate.h"
 #define MIN_WIDTH 5
-#define MAX_WIDTH 30
+#define MAX_WIDTH 10000
 #define MIN_HEIGHT 5
-#define MAX_HEIGHT 30
+#define MAX_HEIGHT 10000
 #define MIN_MINES 1
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x) // a number #defined above as a string
 #define DEBUG_MODE 0
+#define ENDLESS_DENSITY 0.16 // fraction of the tiles that are mines in endless mode
+#define VIEW_ROWS 16 // size of the part of an endless world that is shown
+#define VIEW_COLUMNS 16
+#define HINT_MILLISECONDS 50 // how long a hint may take, unless --hint-ms says otherwise
+#define UNDO_KILOBYTES 4096 // most memory the moves that can be undone take, unless --undo-kb says otherwise
 _Bool test_mode = 0;
+double hint_milliseconds = HINT_MILLISECONDS;
 // max_mine is width * height / 4
 
+// What's on the screen, so that only the tiles that changed have to be redrawn
+Renderer screen;
+_Bool use_renderer = 0; // only when printing to a terminal
+
 // Clear Screen
 void clear_screen()
 {
     if (DEBUG_MODE || test_mode)
         printf("\n\n-- Screen Cleared --\n\n");
     else
-        system("cls || clear");
+    {
+        printf("\033[H\033[2J"); // ANSI escape codes for cursor to the top left and clear the screen
+        render_reset(&screen);
+    }
 }
 
+// say
+//   const char * format, ...: what to print, like printf
+// Prints below the map, keeping count of the lines so the next frame knows whether the screen
+// scrolled (see render_printed)
+void say (const char * format, ...)
+{
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    fputs(text, stdout);
+    render_printed(&screen, text);
+}
+
+// read_line
+//   char * line: output, the line with its '\n' (the rest of a longer line is skipped), or "" at
+//                the end of the input
+//   int size: room in line
+// Reads a line the user typed.  The terminal echoes it below the map, so it's counted like say.
+void read_line (char * line, int size)
+{
+    fflush(stdout);
+    if (fgets(line, size, stdin) == NULL)
+    {
+        line[0] = '\0';
+        return;
+    }
+    render_printed(&screen, line);
+    if (strchr(line, '\n') == NULL)
+    {
+        int c;
+        while ((c = getchar()) != '\n' && c != EOF) continue;
+        render_printed(&screen, "\n");
+    }
+}
 
-/* Game Play Functions */
-// initialize_map
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to output map array
-// Initializes each value to 0
-void initialize_map (int width, int height, int * map);
-
-// plant_mines
-//   int num: number of mines
-//   int width: width of map
-//   int height: height of map
-//   int[][2] mine_positions: pointer to output array of mine positions
-// Sets the positions of each mine in the mine_positions array
-//   mine_positions[i][0] = row
-//   mine_positions[i][1] = column
-void plant_mines (int num, int width, int height, int mine_positions[][2]);
-
-// generate_map
-//   int width: width of map
-//   int height: height of map
-//   int num_mines: number of mines
-//   int * free_positions: number of free positions (adds one for each duplicate mine)
-//   int[][2] mine_positions: positions of mines
-//   int * map: pointer to output map array w/ each tile init. to 0
-//     -19-10 = guessed mine
-//     -9 = mine
-//     -8 through -1 = closed with surrounding mines
-//     0 = closed with no surrounding mines
-//     1-8 = open with surrounding mines
-//     9 = revealed mine (for end game)
-//     10 = open with no surrounding mines
-//
-// Generates the map by looping through each mine and subtracting 1 from each surrounding tile
-// If two or more mines share the same location, it skips that mine and adds one to the number of free positions
-void generate_map (int width, int height, int num_mines, int * free_positions, int mine_positions[][2], int * map);
-
-// reveal_tile
-//   int column: column of revealed tile (starts at 0)
-//   int row: row of revealed tile (starts at 0)
-//   int * score: pointer to score variable
-//   time_t: start time of the game
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map array
-// If the tile is a mine, prints the game over screen
-// If the tile is not a mine, it
-//      * if it's already open, it does nothing
-//      * otherwise, it flips the tile to open
-//      * if it's 0 (now 9), it recursively flips the neighboring tiles
-//      * otherwise, it stops
-//      * increments score whenever a tile is flipped.
-void reveal_tile (int column, int row, int * score, time_t start_time, int width, int height, int * map);
-
-// reveal_map
-//   int width
-//   int height
-//   int * map
-// Reveals the entire map
-void reveal_map (int width, int height, int * map);
-
-// int mark_tile
-//   int row
-//   int column
-//   int * map
-// If the tile is hidden, marks the tile. Returns the original value of the tile or -100 if the row, column is out of range
-int mark_tile (int row, int column, int width, int height, int * map);
 
 /* UI Functions */
 // welcome_screen
@@ -98,41 +93,106 @@ int mark_tile (int row, int column, int width, int height, int * map);
 void welcome_screen (int * width, int * height, int * num_mines);
 
 // lose_screen
-//   int score: number of tiles overturned.
-//   int time: time since start of game in seconds.
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map array
+//   Game * game: the game that was lost
 // Prints a lose screen displaying your score, time, and the revealed map
-void lose_screen (int score, int start_time, int width, int height, int * map);
+void lose_screen (Game * game);
 
 // win_screen
-//   int score: number of tiles overturned.
-//   int start_time: time of start of game in seconds.
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map array
+//   Game * game: the game that was won
 // Prints a win screen displaying your score, time and the revealed map
-void win_screen (int score, int start_time, int width, int height, int * map);
+void win_screen (Game * game);
 
 // mark_screen
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map
+//   Game * game: the game being played
 // Lets the user guess the position of a mine
-void mark_screen (int width, int height, int * map);
-
-// guess_screen
-//   int * score: pointer to veriable for number of tiles cleared
-//   time_t start_time: start time of the game
-//   int * free_positions: pointer to variable for number of free positions.
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map array
+void mark_screen (Game * game);
+
+// show_board
+//   Game * game: the game being played
+//   const char * title: first line of the screen
+// Clears the screen and prints the title, your current score, the number of free positions and
+// the map.  On a terminal only the tiles that changed since the last screen are redrawn.
+void show_board (Game * game, const char * title);
+
+// guess_screen -> _Bool
+//   Game * game: the game being played
 // Prints the number of free positions and your current score
 // Prints map with new guess.
-// Asks user for row and column of guessed tile. 
-void guess_screen (int * score, time_t start_time, int * free_positions, int width, int height, int * map);
+// Asks user for row and column of guessed tile.
+// Returns 0 if the user chose to quit
+_Bool guess_screen (Game * game);
+
+// undo_screen
+//   Game * game: the game that was just lost
+// Shows the map and asks whether to take back the move that lost it (see ms_undo)
+void undo_screen (Game * game);
+
+// probability_screen
+//   Game * game: the game being played
+// Prints the map as a heatmap of the chance of each hidden tile being a mine
+void probability_screen (Game * game);
+
+// hint_screen
+//   Game * game: the game being played
+// Prints the map with a safe tile highlighted (or the tile least likely to be a mine, if none can
+// be proven safe) and which numbers prove it, taking at most about hint_milliseconds
+void hint_screen (Game * game);
+
+// endless_screen -> _Bool
+//   World * world: the endless game being played
+// Prints the score and the part of the world around the last tile revealed
+// Asks user to guess, mark or look at another part of the world.
+// Returns 0 if the user chose to quit
+_Bool endless_screen (World * world);
+
+// save_screen
+//   Game * game: the game the user quit
+//   const char * path: file to save it to, or NULL to not save it
+// Saves the game so it can be carried on with --load, and says whether it worked
+void save_screen (Game * game, const char * path);
+
+// replay_screen
+//   const char * path: journal to play back
+// Plays a journal back (see ms_journal.h) and prints how fast, how the game ended and, if the map
+// is small enough, the map
+void replay_screen (const char * path);
+
+// script_screen -> int
+//   Game * game: the game being played
+//   FILE * in: the moves, one per line (see below)
+//   long long * moves: output, number of moves made
+// Plays the moves without any prompts or redraws.  Each line is "g ROW, COLUMN" to guess a
+// tile, "m ROW, COLUMN" to mark or unmark one, "c ROW, COLUMN" to chord around a number (rows and
+// columns start at 1, like when playing) or "q" to quit.  Blank lines and lines starting with # are skipped, and so is everything
+// after the game is over.
+// Returns 0 when the script ends or the game is over, 1 if it quit, or -1 if a line is wrong
+// (which is printed to stderr with its line number)
+int script_screen (Game * game, FILE * in, long long * moves);
+
+// script_result -> int
+//   Game * game: the game the script played
+//   long long moves: number of moves made
+// Prints how the game ended, in a single line that's easy to pick out in a batch job
+// Returns the exit status for it: 0 = won, 2 = lost, 3 = still playing
+int script_result (Game * game, long long moves);
+
+// settings_error -> const char *
+//   int width, int height, int num_mines: size of the map and number of mines
+//   _Bool simulation: whether the computer will play (it's allowed up to all but the 9 tiles of
+//                     the opening to be mines, instead of a ninth of the tiles)
+// Checks the settings against the same limits as the welcome screen
+// Returns what's wrong with them, or NULL if they're fine
+const char * settings_error (int width, int height, int num_mines, _Bool simulation);
+
+// simulate_screen
+//   int width, int height, int num_mines: settings of every game
+//   Policy policy: how the computer plays (see ms_simulate.h)
+//   long long games: number of games to play
+//   uint64_t seed: seed the games come from
+//   int threads: number of threads to play on (0 = one per core)
+// Plays the games on every core and prints the win rate with its confidence interval and how
+// many games were played per second
+void simulate_screen (int width, int height, int num_mines, Policy policy, long long games, uint64_t seed, int threads);
 
 // test_screen
 // Asks user if they want to play the game or test the game.  If they want to test, it runs test cases and then exists the program
@@ -141,242 +201,358 @@ void test_screen();
 // draw_tile
 //   int row: row of the tile (starts at 0)
 //   int column: column of tile (starts at 0)
-//   int width: width of map
-//   int * map: pointer to map array
+//   const Board * map: pointer to map
+//   const double * heatmap: chance of each tile being a mine (from mine_probabilities), or NULL
 // Prints a single map tile according to the following format
-//      -19 through -10 = ?
-//      -9 through 0 = #
-//      1-8 = 1-8
-//      9 = *
-//      10 = 0
-void draw_tile (int column, int row, int width, int * map);
+//      marked = ?
+//      hidden = . (or with a heatmap, the chance of a mine in tenths, + if it's safe or * if
+//               it's certainly a mine, coloured green, yellow or red)
+//      open with surrounding mines = 1-8
+//      open mine = #
+//      open with no surrounding mines = (space)
+void draw_tile (int column, int row, const Board * map, const double * heatmap);
 
 // draw_map
-//   int width: width of map
-//   int height: height of map
-//   int * map: pointer to map array
-// Prints the map with the number for each column and row and each tile using draw_tile. 
-void draw_map (int width, int height, int * map);
+//   const Board * map: pointer to map
+//   const double * heatmap: chance of each tile being a mine, or NULL for the normal map
+//   long long highlight: index of a tile to show in reverse video, or -1
+// Prints the map with the number for each column and row and each tile (like draw_tile) in a
+// single write (see render_map in ms_render.h).
+void draw_map (const Board * map, const double * heatmap, long long highlight);
+
+// draw_world
+//   const World * world: the endless game
+//   long long top, long long left: world row and column of the top left tile shown
+// Prints VIEW_ROWS x VIEW_COLUMNS tiles of the world like draw_map, numbered with their world
+// rows and columns (which can be negative).
+void draw_world (const World * world, long long top, long long left);
 
 
 /* Main */
-int main (void)
+int main (int argc, char * argv[])
 {
-    // Random
-    srand(time(NULL));
-
-    // Ask if user wants to play the game or test the game
-    /*test_screen();*/
-
-    // Map
-    int width, height, num_mines;
-    welcome_screen(&width, &height, &num_mines);
-
-    int map[width][height];
-    int mine_positions[num_mines][2];
-    initialize_map(width, height, (int *)map);
-    plant_mines(num_mines, width, height, mine_positions);
-    
-    // Score
-    time_t start_time = time(NULL);
-    int score = 0; // number of cleared tiles
-    int num_free = width * height - num_mines; // number of free spaces left
-    
-    // Generate Map
-    printf("num_mines = %d\n", num_mines);
-    generate_map(width, height, num_mines, &num_free, mine_positions, (int *)map);
-    printf("num_mines = %d\n", num_mines);
-
-    // Make Guesses Until the Game is over
-    while (num_free > 0)
+    render_init(&screen, stdout);
+
+    // Random (the same seed and settings always give the same map)
+    uint64_t seed = rng_time_seed();
+    _Bool no_guess = 0; // only give maps that can be won without guessing
+    _Bool endless = 0; // play on a world with no edges instead
+    _Bool view = 0; // play in a scrolling curses view instead of printing the whole map
+    const char * save_path = NULL; // where to save the game if the user quits
+    const char * load_path = NULL; // saved game to carry on with
+    _Bool check_load = 0; // checksum the whole saved map when loading it, not just the header
+    const char * journal_path = NULL; // where to record every move
+    const char * replay_path = NULL; // journal to play back
+    const char * script_path = NULL; // moves to play without prompts ("-" = standard input)
+    int width = 0, height = 0, num_mines = 0; // 0 = ask on the welcome screen
+    const char * serve_address = NULL; // serve games over a socket instead of playing one
+    int threads = 0; // threads for the server or a simulation (0 = one per core)
+    long long simulations = 0; // games to simulate instead of playing one
+    Policy policy = POLICY_SOLVER; // how simulated games are played
+    size_t undo_bytes = (size_t)UNDO_KILOBYTES * 1024; // cap on the moves that can be undone
+    for (int i = 1; i < argc; i ++)
     {
-        guess_screen(&score, start_time, &num_free, width, height, (int *)map);
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--no-guess") == 0)
+            no_guess = 1;
+        else if (strcmp(argv[i], "--endless") == 0)
+            endless = 1;
+        else if (strcmp(argv[i], "--view") == 0)
+            view = 1;
+        else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+            save_path = argv[++i];
+        else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc)
+            load_path = argv[++i];
+        else if (strcmp(argv[i], "--check") == 0)
+            check_load = 1;
+        else if (strcmp(argv[i], "--journal") == 0 && i + 1 < argc)
+            journal_path = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            replay_path = argv[++i];
+        else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc)
+            script_path = argv[++i];
+        else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc)
+            width = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc)
+            height = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--mines") == 0 && i + 1 < argc)
+            num_mines = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+            serve_address = argv[++i];
+        else if (strcmp(argv[i], "--hint-ms") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0)
+            hint_milliseconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--undo-kb") == 0 && i + 1 < argc && atoll(argv[i + 1]) > 0)
+            undo_bytes = (size_t)atoll(argv[++i]) * 1024;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc && atoll(argv[i + 1]) > 0)
+            simulations = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc && strcmp(argv[i + 1], "solver") == 0)
+            policy = POLICY_SOLVER, i ++;
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc && strcmp(argv[i + 1], "probability") == 0)
+            policy = POLICY_PROBABILITY, i ++;
+        else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc && strcmp(argv[i + 1], "random") == 0)
+            policy = POLICY_RANDOM, i ++;
+        else
+        {
+            printf("Usage: %s [--width N --height N --mines N] [--seed N] [--no-guess | --endless] [--view | --script FILE]\n", argv[0]);
+            printf("       %*s [--save FILE] [--load FILE [--check]] [--journal FILE] [--hint-ms MILLISECONDS] [--undo-kb N]\n", (int)strlen(argv[0]), "");
+            printf("       %s --replay FILE\n", argv[0]);
+            printf("       %s --serve ADDRESS [--threads N]\n", argv[0]);
+            printf("       %s --simulate GAMES --width N --height N --mines N [--policy solver|probability|random] [--seed N] [--threads N]\n", argv[0]);
+            return 1;
+        }
     }
 
-    return 0;
-}
+    _Bool sized = width != 0 || height != 0 || num_mines != 0;
+    if (sized && settings_error(width, height, num_mines, simulations > 0) != NULL)
+    {
+        printf("ERROR: %s\n", settings_error(width, height, num_mines, simulations > 0));
+        return 1;
+    }
+    if (script_path != NULL && (endless || view || (!sized && load_path == NULL)))
+    {
+        printf("ERROR: A script needs --width, --height and --mines (or --load), and can't be endless or use the view\n");
+        return 1;
+    }
+    if (endless && (save_path != NULL || load_path != NULL || journal_path != NULL))
+    {
+        printf("ERROR: Endless games can't be saved or recorded\n");
+        return 1;
+    }
+    if (load_path != NULL && journal_path != NULL)
+    {
+        printf("ERROR: Only new games can be recorded (a journal starts from the seed)\n");
+        return 1;
+    }
 
+    // Win rate of many games played by the computer
+    if (simulations > 0)
+    {
+        if (!sized)
+        {
+            printf("ERROR: A simulation needs --width, --height and --mines\n");
+            return 1;
+        }
+        simulate_screen(width, height, num_mines, policy, simulations, seed, threads);
+        return 0;
+    }
 
-// Initinalize the map to have all 0's
-void initialize_map (int width, int height, int * map)
-{
-    for (int row = 0; row < height; row ++)
+    // Server for any number of games (see ms_server.h for the protocol)
+    if (serve_address != NULL)
     {
-        for (int column = 0; column < width; column ++)
+        int listener = server_listen(serve_address);
+        if (listener < 0)
         {
-            *(map + row*width + column) = 0; // Set map[i][j] = 0
+            printf("ERROR: Could not listen on %s\n", serve_address);
+            return 1;
         }
+        printf("Serving games on %s\n", serve_address);
+        fflush(stdout);
+        server_run(listener, threads);
+        printf("ERROR: The server stopped\n");
+        return 1;
     }
-}
 
-// Generate a bunch of random mine positions
-void plant_mines (int num, int width, int height, int mine_positions[][2])
-{
-    for (int i = 0; i < num; i ++)
+    // Play a journal back as fast as possible and show how the game ended
+    if (replay_path != NULL)
     {
-        mine_positions[i][0] = rand() % height; // Random row position
-        mine_positions[i][1] = rand() % width; // Random column position
+        replay_screen(replay_path);
+        return 0;
     }
-}
+    if (save_path == NULL) save_path = load_path; // a loaded game is saved back to where it came from
 
-// Create the list of numbers that are hidden behind each tile (assumes map is initialized with 0's)
-void generate_map (int width, int height, int num_mines, int * free_positions, int mine_positions[][2], int * map)
-{
-    // For each mine, add one to the surrounding zero
-    for (int i = 0; i < num_mines; i ++)
+    // Endless game (there's no size to ask for and it can't be won)
+    if (endless)
     {
-        int * mine = mine_positions[i];
+        World * world = world_new(seed, ENDLESS_DENSITY);
+        if (world == NULL)
+        {
+            printf("ERROR: Could not create an endless world\n");
+            return 1;
+        }
+        time_t start_time = time(NULL);
+        while (world->status == MS_PLAYING)
+        {
+            if (!endless_screen(world)) break;
+        }
+
+        clear_screen();
+        if (world->status == MS_LOST)
+            printf("KABOOM!!!!\nYou stepped on a mine!\n\n");
+        printf("Score: %lld\n", world->score);
+        printf("Time: %ld seconds\n", (long)(time(NULL) - start_time));
+        printf("Seed: %llu\n", (unsigned long long)world->seed);
+        printf("MAP:\n");
+        draw_world(world, world->last_row - VIEW_ROWS / 2, world->last_column - VIEW_COLUMNS / 2);
+        world_free(world);
+        return 0;
+    }
 
-        if (DEBUG_MODE) draw_map(width, height, map);
+    // Ask if user wants to play the game or test the game
+    /*test_screen();*/
 
-        // Set the mine position in the map as a mine
-        int * tile = (map + mine[0]*width + mine[1]);
-        if (*tile == -9 || *tile == -19 | *tile == 9) // If the tile already has a mine placed, ingore the second one
+    // Map (either a saved one or a new one)
+    Game * game;
+    if (load_path != NULL)
+    {
+        // Only the header is checked unless asked, so a big map loads without reading all of it
+        SaveResult result = ms_load(load_path, check_load, &game);
+        if (result != SAVE_OK)
         {
-            *free_positions = *free_positions + 1;
-            continue;
+            printf("ERROR: Could not load %s: %s\n", load_path,
+                   result == SAVE_CANT_OPEN ? "could not open the file" :
+                   result == SAVE_NOT_A_SAVE ? "not a saved game (or saved by another version)" :
+                   result == SAVE_CORRUPTED ? "the file is damaged" : "not enough memory");
+            return 1;
         }
-        // otherwise, set the tile to be a mine
-       *tile = -9;
+    }
+    else
+    {
+        if (!sized) welcome_screen(&width, &height, &num_mines);
 
-        // Subtract one from all neighboring tiles (unless it's a mine)
-        for (int j = -1; j <= 1; j ++)
+        // A no-guess map starts with the middle tile already open
+        game = no_guess ? ms_new_no_guess(width, height, num_mines, seed, height / 2, width / 2, 0)
+                        : ms_new(width, height, num_mines, seed);
+        if (game == NULL)
         {
-            for (int k = -1; k <= 1; k ++)
-            {
-                // Don't change the tile we just turned into a mine
-                if (j == 0 && k == 0) continue;
-
-                // Get the row and column of the neighboring tile
-                int row = mine[0] + j;
-                int column = mine[1] + k;
-                
-                // If the index is out of range
-                if (row < 0 || column < 0 || row >= height || column >= width) continue;
-
-                // Get the address of the neighboring tile
-                tile = map + (row*width + column);
-
-                // If the neighbor's a mine
-                // Technically, only (*tile == -9) matters since the other options only show after
-                //   the game starts and the map is already generated
-                if (*tile == -9 || *tile == -19 || *tile == 9) continue;
-
-                // If tile is negative (hidden), subtract one (add one neighboring mine)
-                if (*tile <= 0) *tile = *tile - 1;
-                // If the tile is 10 (open 0), set it to 1
-                else if (*tile == 10) *tile = 1;
-                // If the tile is positive (open), add one
-                else *tile = *tile + 1;
-            }
+            printf("ERROR: Could not create a %d x %d map%s\n", width, height, no_guess ? " that can be won without guessing" : "");
+            return 1;
         }
     }
-}
 
-void reveal_tile (int column, int row, int * score, time_t start_time, int width, int height, int * map)
-{
-    // Check if the tile is out of range
-    if (column >= 0 && column < width && row >= 0 && row < height)
+    // Record every move
+    Journal journal;
+    FILE * journal_file = NULL;
+    if (journal_path != NULL)
     {
-        // Pointer to the map tile to be revealed
-        int * tile = map + (row * width + column);
-
-        // If it's a mine
-        if (*tile == -9 || *tile == -19 || *tile == 9)
+        journal_file = fopen(journal_path, "wb");
+        if (journal_file == NULL || journal_start(&journal, journal_file, game, no_guess, game->height / 2, game->width / 2) != 0)
         {
-            lose_screen(*score, start_time, width, height, map);
+            printf("ERROR: Could not write the journal to %s\n", journal_path);
+            return 1;
         }
-        // Otherwise, only if the tile hasn't already been flipped, flip it
-        else if (*tile <= 0)
-        {
-            // Increment the score
-            *score = *score + 1;
+    }
 
-            // If it's zero, set it to ten and flip its neighbors
-            if (*tile == 0 || *tile == -10)
-            {
-                *tile = 10; // Flip the tile
-                
-                // Loop through neighbors
-                for (int i = -1; i <= 1; i ++)
-                {
-                    for (int j = -1; j <= 1; j ++)
-                    {
-                        if (i == 0 && j == 0) continue;
-                        reveal_tile(column + i, row + j, score, start_time, width, height, map);
-                    }
-                }
-            }       
-            // If it has been flagged, add ten and then flip the sign
-            else if (*tile < -10)
-                *tile = -(*tile + 10);
-            // If it's just an ordinary hidden tile, flip its sign
-            else
-                *tile = -(*tile);
+    // Scripted game (nothing but the result is printed, so thousands can be run from a batch job)
+    if (script_path != NULL)
+    {
+        FILE * in = strcmp(script_path, "-") == 0 ? stdin : fopen(script_path, "r");
+        if (in == NULL)
+        {
+            printf("ERROR: Could not open the script %s\n", script_path);
+            return 1;
         }
+        long long moves;
+        int result = script_screen(game, in, &moves);
+        if (in != stdin) fclose(in);
+        int status = result < 0 ? 1 : script_result(game, moves);
+        if (result == 1) save_screen(game, save_path);
+        ms_free(game);
+        if (journal_file != NULL) fclose(journal_file);
+        return status;
     }
-}
 
-// Reveals the entire map for end game
-void reveal_map (int width, int height, int * map)
-{
-    // Loop through each tile
-    for (int column = 0; column < width; column ++)
+    // Moves can be taken back, except while recording a journal (which would still play them back)
+    if (journal_file == NULL && ms_history_start(game, undo_bytes) != 0)
+        printf("Not enough memory to keep moves to undo, so they can't be taken back.\n");
+
+    // Scrolling view (the map could be far too big to print at the end, so only the result is)
+    if (view)
     {
-        for (int row = 0; row < height; row ++)
+        if (viewport_play(game) != 0)
+            printf("ERROR: Could not start the scrolling view on this terminal\n");
+        else if (ms_status(game) != MS_PLAYING)
         {
-            int * tile = map + (row*width + column);
-
-            // Format each tile correctly
-            if (*tile >= -19 && *tile < -10) // Hidden Tile Marked as Potential Mine
-                *tile = -(*tile + 10);
-            else if (*tile < 0) // Hidden Tile
-                *tile = -*tile;
-            else if (*tile == -10 || *tile == 10 || *tile == 0) // Tile with no neighbors
-                *tile = 10; // Make all tiles with no neighbors have the same format
+            printf(ms_status(game) == MS_WON ? "YOU WIN!!!\n\n" : "KABOOM!!!!\n\n");
+            printf("Score: %lld\n", game->score);
+            printf("Time: %ld seconds\n", (long)(time(NULL) - game->start_time));
+            printf("Seed: %llu\n", (unsigned long long)game->seed);
         }
+        else
+            save_screen(game, save_path);
+        ms_free(game);
+        if (journal_file != NULL) fclose(journal_file);
+        return 0;
     }
+
+    // Make Guesses Until the Game is over.  The frontier is kept up to date from here on, so a
+    // hint only has to look at the numbers next to it (if there isn't the memory for it, hints
+    // look at every open tile instead).
+    use_renderer = !DEBUG_MODE && isatty(STDOUT_FILENO);
+    frontier_track(&game->map);
+    while (ms_status(game) == MS_PLAYING)
+    {
+        if (!guess_screen(game)) break;
+        if (ms_status(game) == MS_LOST && game->history != NULL && game->history->undos > 0) undo_screen(game);
+    }
+
+    if (ms_status(game) == MS_WON)
+        win_screen(game);
+    else if (ms_status(game) == MS_LOST)
+        lose_screen(game);
+    else
+        save_screen(game, save_path);
+
+    render_free(&screen);
+    ms_free(game);
+    if (journal_file != NULL) fclose(journal_file);
+    return 0;
 }
 
+
 // Draw an individual tile
-void draw_tile (int column, int row, int width, int * map)
+void draw_tile (int column, int row, const Board * map, const double * heatmap)
 {
-    int tile = *(map + row*width + column); 
+    size_t index = tile_index(map, row, column);
+    int count = tile_count(map, index);
     if (DEBUG_MODE) // so that you can print extra information when debugging
     {
-        if (tile >= -19 && tile <= -10) // Hidden Tile Marked as Potential Mine
+        if (test_bit(map->flags, index)) // Hidden Tile Marked as Potential Mine
             printf("?");
-        else if (tile == 10 || tile == 0) // Revealed Tile with No Neighboring Mines
+        else if (test_bit(map->mines, index)) // Mine (hidden or not)
+            printf(test_bit(map->revealed, index) ? "#" : "9");
+        else if (count == 0) // Tile with No Neighboring Mines
             printf(".");
-        else if (tile < 0) // Hidden Tile
-            printf("%d", -tile);
-        else if (tile <= 8) // Revealed Tile with Neighboring Mines
-            printf("%d", tile);
-        else if (tile == 9) // Revealed Mines
-            printf("#");
-        else // Error
-            printf("E: %d", tile);
+        else // Tile with Neighboring Mines (hidden or not)
+            printf("%d", count);
     }
     else // here's what normally gets printed
     {
-        if (tile >= -19 && tile <= -10) // Hidden Tile Marked as Potential Mine
+        if (test_bit(map->flags, index)) // Hidden Tile Marked as Potential Mine
             printf("?");
-        else if (tile <= 0) // Hidden Tile
+        else if (!test_bit(map->revealed, index) && heatmap != NULL) // Hidden Tile on the Heatmap
+        {
+            double chance = heatmap[index];
+            const char * colour = chance < 0.1 ? "\033[32m" : chance < 0.3 ? "\033[33m" : "\033[31m";
+            if (chance <= 0)
+                printf("%s+\033[0m", colour);
+            else if (chance >= 1)
+                printf("%s*\033[0m", colour);
+            else
+                printf("%s%d\033[0m", colour, (int)(chance * 10));
+        }
+        else if (!test_bit(map->revealed, index)) // Hidden Tile
             printf(".");
-        else if (tile <= 8) // Revealed Tile with Neighboring Mines
-            printf("%d", tile);
-        else if (tile == 9) // Revealed Mines
+        else if (test_bit(map->mines, index)) // Revealed Mines
             printf("#");
-        else if (tile == 10) // Revealed Tile with No Neighboring Mines
+        else if (count > 0) // Revealed Tile with Neighboring Mines
+            printf("%d", count);
+        else // Revealed Tile with No Neighboring Mines
             printf(" ");
-        else // Error
-            printf("E: %d", tile);
     }
 }
 
 // Draw the entire map
-void draw_map (int width, int height, int * map)
+void draw_map (const Board * map, const double * heatmap, long long highlight)
 {
+    // Normally the whole map is put together in one buffer and printed with one write
+    if (!DEBUG_MODE && render_map(&screen, map, heatmap, highlight) == 0) return;
+
+    int width = map->width;
+    int height = map->height;
+
     // Loop through the map, plus an extra column and row before and after for printing column/row
     //   numbers and for printing the map border
     for (int row = -1; row < height+1; row ++)
@@ -400,27 +576,140 @@ void draw_map (int width, int height, int * map)
             // Column Numbers
             else if (row == -1)
             {
-                char colStr[5];
+                char colStr[12];
                 sprintf(colStr, "C%d", column + 1);
                 printf("%-4s", colStr); // Pads with spaces on the right so that it's total width is 4 
             }
             // Row Numbers
             else if (column == -1)
             {
-                char rowStr[5];
+                char rowStr[12];
                 sprintf(rowStr, "R%d", row + 1);
                 printf("%-4s", rowStr); // Pads with spaces on the right so that it's total width is 4
             }
             // Tiles
             else
             {
-                draw_tile(column, row, width, map);
+                _Bool highlighted = (long long)tile_index(map, row, column) == highlight;
+                if (highlighted) printf("\033[7m");
+                draw_tile(column, row, map, heatmap);
+                if (highlighted) printf("\033[0m");
                 printf("   "); // Print 3 extra spaces so that it's total width is 4 (since tiles are one character long)
             }
         }
     }
 }
 
+// Draw part of an endless world
+void draw_world (const World * world, long long top, long long left)
+{
+    // Same layout as draw_map, except the numbers are world positions and can be wider
+    printf("%-8s", "");
+    for (int column = 0; column < VIEW_COLUMNS; column ++)
+    {
+        char colStr[24];
+        sprintf(colStr, "C%lld", left + column);
+        printf("%-6s", colStr);
+    }
+    printf("\n");
+
+    for (int row = 0; row < VIEW_ROWS; row ++)
+    {
+        char rowStr[24];
+        sprintf(rowStr, "R%lld", top + row);
+        printf("%-8s", rowStr);
+        for (int column = 0; column < VIEW_COLUMNS; column ++)
+        {
+            int count = 0;
+            WorldTile tile = world_tile(world, top + row, left + column, &count);
+            if (tile == WORLD_MARKED)
+                printf("?");
+            else if (tile == WORLD_MINE)
+                printf("#");
+            else if (tile == WORLD_HIDDEN)
+                printf(".");
+            else if (count > 0)
+                printf("%d", count);
+            else
+                printf(" ");
+            printf("     "); // 6 wide, like the column numbers
+        }
+        printf("|\n");
+    }
+}
+
+_Bool endless_screen (World * world)
+{
+    // The view follows the last tile revealed until the user moves it
+    static long long top, left;
+    static long long last_row = 0, last_column = 0;
+    static _Bool moved = 0;
+    if (!moved || last_row != world->last_row || last_column != world->last_column)
+    {
+        last_row = world->last_row;
+        last_column = world->last_column;
+        top = last_row - VIEW_ROWS / 2;
+        left = last_column - VIEW_COLUMNS / 2;
+        moved = 1;
+    }
+
+    clear_screen();
+
+    // Print current score/status
+    printf("STATUS:\n");
+    printf("Score: %lld\n", world->score);
+    printf("Chunks Explored: %zu\n\n", world->num_chunks);
+
+    // Print the part of the world being looked at
+    printf("MAP (rows %lld to %lld, columns %lld to %lld):\n", top, top + VIEW_ROWS - 1, left, left + VIEW_COLUMNS - 1);
+    draw_world(world, top, left);
+    printf("\n");
+
+    char option;
+    do {
+        printf("ENTER m TO MARK A MINE, g TO GUESS AN EMPTY SPACE, v TO LOOK AT ANOTHER PART OF THE WORLD OR q TO QUIT: ");
+        option = getchar();
+        while (option != '\n' && option != EOF && getchar() != '\n') continue;
+        if (option == EOF) return 0;
+        if (option != 'm' && option != 'g' && option != 'v' && option != 'q') printf("Option not recognised.  Please type either 'm', 'g', 'v' or 'q' (without the quotes).\n\nTry again\n");
+    } while (option != 'm' && option != 'g' && option != 'v' && option != 'q');
+    printf("You entered %c\n\n", option);
+    if (option == 'q')
+        return 0;
+
+    // Any row and column is on the map, so only the format can be wrong
+    long long row, column;
+    if (option == 'v')
+        printf("Enter the row and column to look at separated by a comma (e.g. -40, 12)\n");
+    else
+        printf("Enter the row and column number separated by a comma (e.g. -40, 12)\n");
+    while (scanf("%lld, %lld", &row, &column) != 2)
+    {
+        if (feof(stdin)) return 0;
+        printf("ERROR: Incorrect format.  Make sure you enter two integers separated by just a comma and optionally a space.\nTry again.\n\n");
+        while (getchar() != '\n') {}
+    }
+    while (getchar() != '\n') {}
+
+    MsResult result = MS_OK;
+    if (option == 'v')
+    {
+        top = row - VIEW_ROWS / 2;
+        left = column - VIEW_COLUMNS / 2;
+    }
+    else if (option == 'm')
+        result = world_mark(world, row, column);
+    else
+        result = world_reveal(world, row, column);
+
+    if (result == MS_NO_MEMORY)
+    {
+        printf("ERROR: Not enough memory to explore any further\n");
+        return 0;
+    }
+    return 1;
+}
+
 // Welcome Screen and initial user input
 void welcome_screen (int * width, int * height, int * num_mines)
 {
@@ -467,174 +756,387 @@ void welcome_screen (int * width, int * height, int * num_mines)
     printf("Perfect!  Now let's get started!\n\n");
 }
 
-// Mark a tile as a potential mine
-int mark_tile (int row, int column, int width, int height, int * map)
-{
-    // If (row, column) is out of range, return -100
-    if (row >= height || column >= width || row < 0 || column < 0) return -100;
-
-    // Find the tile to be marked
-    int * tile = map + row*width + column;
-    int original_tile = *tile;
-
-    // If the tile is hidden but unmarked, mark it
-    if (*tile >= -9 && *tile <= 0)
-        *tile = *tile - 10;
-    // If the tile is hidden but already marked, unmark it
-    else if (*tile < -9)
-        *tile = *tile + 10;
-    // Otherwise, do nothing to it
-
-    // Return the original_tile so that you can error handle when unhidden tiles are marked
-    return original_tile;
-}
-
 // User input for marking tiles
-void mark_screen (int width, int height, int * map)
+void mark_screen (Game * game)
 {
-    // Clear the screen
-    clear_screen();
+    int width = game->width;
+    int height = game->height;
 
     // Display title and map
-    printf("Mark/Unmark a Tile as a Potential Mine:\n\n");
-    draw_map(width, height, map);
+    show_board(game, "Mark/Unmark a Tile as a Potential Mine:");
 
     // Get the row and column of the tile you want to mark
     int row, column;
-    printf("ENTER THE TILE YOU WANT TO MARK/UNMARK\n");
+    say("ENTER THE TILE YOU WANT TO MARK/UNMARK\n");
     do
     {
-        printf("Enter the row and column number separated by a comma (e.g. 5, 3)\n");
-        printf("Row must be whole number from 1-%d\n", height);
-        printf("Column must be whole number from 1-%d\n", width);
+        say("Enter the row and column number separated by a comma (e.g. 5, 3)\n");
+        say("Row must be whole number from 1-%d\n", height);
+        say("Column must be whole number from 1-%d\n", width);
 
         // Make sure the input is valid
-        if (scanf("%d, %d", &row, &column) != 2)
-            printf("ERROR: Incorrect format.  Make sure you enter two integers separated by just a comma and optionally a space.\nTry again.\n\n");
+        char line[256];
+        read_line(line, sizeof(line));
+        if (sscanf(line, "%d, %d", &row, &column) != 2)
+            say("ERROR: Incorrect format.  Make sure you enter two integers separated by just a comma and optionally a space.\nTry again.\n\n");
         else if (row < 1 || column < 1 || row > height || column > width)
         {
-            printf("Please make sure the row and column are within the correct range.\n");
-            printf("You inputted row = %d, column = %d\n", row, column);
-            printf("Try again.\n\n");
+            say("Please make sure the row and column are within the correct range.\n");
+            say("You inputted row = %d, column = %d\n", row, column);
+            say("Try again.\n\n");
         }
-
-        // Clear the rest of the buffer
-        while (getchar() != '\n') {}
     } while (row < 1 || column < 1 || row > height || column > width);
 
-    clear_screen();
-    printf("Mark/Unmark a Tile as a Potential Mine:\n\n");
-
-    int result = mark_tile(row-1, column-1, width, height, map);
-    draw_map(width, height, map);
-    if (result > 0) printf("\nTile has already been revealed.\n\n");
+    MsResult result = ms_mark(game, row-1, column-1);
+    show_board(game, "Mark/Unmark a Tile as a Potential Mine:");
+    if (result == MS_NO_CHANGE) say("\nTile has already been revealed.\n\n");
 
-    printf("Would you like to mark/unmark another tile?\n");
+    say("Would you like to mark/unmark another tile?\n");
     char cont;
     do {
-        printf("Enter y for yes, or n for no: ");
-        cont = getchar();
-        while (getchar() != '\n') continue;
-        if (cont != 'y' && cont != 'n') printf("You must enter either 'y' or 'n' (without the quotes).\nTry again.\n\n");
+        say("Enter y for yes, or n for no: ");
+        char line[256];
+        read_line(line, sizeof(line));
+        cont = line[0];
+        if (cont != 'y' && cont != 'n') say("You must enter either 'y' or 'n' (without the quotes).\nTry again.\n\n");
     } while (cont != 'y' && cont != 'n');
-    printf("You entered %c\n\n", cont);
+    say("You entered %c\n\n", cont);
 
-    if (cont == 'y') mark_screen(width, height, map);
+    if (cont == 'y') mark_screen(game);
 }
 
 
-void guess_screen (int * score, time_t start_time, int * free_positions, int width, int height, int * map)
+void show_board (Game * game, const char * title)
 {
-    // Clear screen
-    clear_screen();
+    char header[256];
+    snprintf(header, sizeof(header), "%s\nScore: %lld\nRemaining Tiles to Clear: %lld\n\nMAP:\n",
+             title, game->score, game->free_positions);
 
-    // Print current score/status
-    printf("STATUS:\n");
-    printf("Score: %d\n", *score);
-    printf("Remaining Tiles to Clear: %d\n\n", *free_positions);
+    if (!use_renderer || test_mode || render_frame(&screen, header, &game->map) != 0)
+    {
+        clear_screen();
+        printf("%s", header);
+        draw_map(&game->map, NULL, -1);
+    }
+}
 
-    // Print map
-    printf("MAP:\n");
-    draw_map(width, height, map);
-    printf("\n");
+_Bool guess_screen (Game * game)
+{
+    int width = game->width;
+    int height = game->height;
+
+    // Print current score/status and the map
+    show_board(game, "STATUS:");
+    say("\n");
 
         // Get Row and Column
     int row, column;
+    char option;
     do
     {
-        char option;
         do {
-            printf("ENTER m TO MARK A MINE, g TO GUESS AN EMPTY SPACE OR q TO QUIT: ");
-            option = getchar();
-            while (getchar() != '\n') continue;
-            if (option != 'm' && option != 'g' && option != 'q') printf("Option not recognised.  Please type either 'm', 'g', or 'q' (without the quotes).\n\nTry again\n");
-        } while (option != 'm' && option != 'g' && option != 'q');
-        printf("You entered %c\n\n", option);
+            say("ENTER m TO MARK A MINE, g TO GUESS AN EMPTY SPACE, c TO CHORD (OPEN EVERYTHING AROUND A NUMBER WHOSE MINES ARE ALL MARKED),\n");
+            say("p TO SHOW MINE PROBABILITIES, h FOR A HINT, u TO UNDO, r TO REDO OR q TO QUIT: ");
+            char line[256];
+            read_line(line, sizeof(line));
+            option = line[0];
+            if (option == '\0' || strchr("mgcphurq", option) == NULL) say("Option not recognised.  Please type either 'm', 'g', 'c', 'p', 'h', 'u', 'r' or 'q' (without the quotes).\n\nTry again\n");
+        } while (option == '\0' || strchr("mgcphurq", option) == NULL);
+        say("You entered %c\n\n", option);
 
         if (option == 'q')
-            exit(0);
+            return 0;
+        else if (option == 'u' || option == 'r')
+        {
+            // The next screen shows the map as it was
+            if ((option == 'u' ? ms_undo(game) : ms_redo(game)) == MS_NO_CHANGE)
+            {
+                say(game->history == NULL ? "Moves can't be taken back in a game that is being recorded in a journal.\n"
+                       : option == 'u' ? "There's no move left to undo.\n" : "There's no move to redo.\n");
+                say("Press enter to carry on.\n");
+                char line[256];
+                read_line(line, sizeof(line));
+            }
+            return 1;
+        }
         else if (option == 'm')
-            mark_screen(width, height, map);
-
-        printf("\nGuess a Clear space\nENTER GUESS:\n");
-
-        printf("Enter the row and column number separated by a comma (e.g. 5, 3)\n");
-        printf("Row must be whole number from 1-%d\n", height);
-        printf("Column must be whole number from 1-%d\n", width);
-        if (scanf("%d, %d", &row, &column) != 2)
-            printf("ERROR: Incorrect format.  Make sure you enter two integers separated by just a comma and optionally a space.\nTry again.\n\n");
+            mark_screen(game);
+        else if (option == 'p')
+            probability_screen(game);
+        else if (option == 'h')
+            hint_screen(game);
+
+        if (option == 'c')
+            say("\nChord around a number\nENTER THE NUMBER'S TILE:\n");
+        else
+            say("\nGuess a Clear space\nENTER GUESS:\n");
+
+        say("Enter the row and column number separated by a comma (e.g. 5, 3)\n");
+        say("Row must be whole number from 1-%d\n", height);
+        say("Column must be whole number from 1-%d\n", width);
+        char line[256];
+        read_line(line, sizeof(line));
+        if (sscanf(line, "%d, %d", &row, &column) != 2)
+            say("ERROR: Incorrect format.  Make sure you enter two integers separated by just a comma and optionally a space.\nTry again.\n\n");
         else if (row < 1 || column < 1 || row > height || column > width)
         {
-            printf("Please make sure the row and column are within the correct range.\n");
-            printf("You inputted row = %d, column = %d\n", row, column);
-            printf("Try again.\n\n");
+            say("Please make sure the row and column are within the correct range.\n");
+            say("You inputted row = %d, column = %d\n", row, column);
+            say("Try again.\n\n");
         }
-        while (getchar() != '\n') {}
     } while (row < 1 || column < 1 || row > height || column > width);
 
-    // Flip the 
-    *free_positions = *free_positions + *score; // Get back original free positions
-    reveal_tile(column-1, row-1, score, start_time, width, height, (int *)map);
-    *free_positions = *free_positions - *score; // Adjust the number of free positions
-    printf("free_positions: %d\n", *free_positions); // Subtract total score from original free positions
-                                               
-    // Win Screen
-    if (*free_positions <= 0)
+    // Flip the tile, or every unmarked tile around the number (the engine keeps track of the
+    // score, free positions and whether we won or lost)
+    if (option == 'c')
     {
-        win_screen(*score, start_time, width, height, map);
+        if (ms_chord(game, row-1, column-1) == MS_NO_CHANGE)
+            say("Only an open number with exactly that many marks around it can be chorded.\n");
     }
+    else
+        ms_reveal(game, row-1, column-1);
+    say("free_positions: %lld\n", game->free_positions);
+
+    return 1;
 }
     
-void lose_screen (int score, int start_time, int width, int height, int * map)
+void undo_screen (Game * game)
+{
+    show_board(game, "KABOOM!!!!  You stepped on a mine.");
+    say("\nWould you like to take that move back?\n");
+    char option;
+    do {
+        say("Enter y for yes, or n for no: ");
+        char line[256];
+        read_line(line, sizeof(line));
+        option = line[0];
+        if (option != 'y' && option != 'n') say("You must enter either 'y' or 'n' (without the quotes).\nTry again.\n\n");
+    } while (option != 'y' && option != 'n');
+    if (option == 'y') ms_undo(game);
+}
+
+// Heatmap of the chance of a mine under each hidden tile
+void probability_screen (Game * game)
+{
+    double * heatmap = malloc(sizeof(double) * game->width * game->height);
+    if (heatmap == NULL)
+    {
+        printf("ERROR: Not enough memory to work out the probabilities\n");
+        return;
+    }
+
+    int result = mine_probabilities(&game->map, game->num_mines, heatmap);
+    if (result == 0)
+    {
+        printf("MINE PROBABILITIES:\n");
+        draw_map(&game->map, heatmap, -1);
+        printf("\nHidden tiles show the chance of a mine in tenths (0 = under 10%%, 9 = 90%% or more),\n");
+        printf("+ = certainly safe, * = certainly a mine.  Marked tiles are counted as mines.\n\n");
+    }
+    else if (result == 1)
+        printf("No arrangement of the mines fits the map.  Is one of your marks wrong?\n\n");
+    else
+        printf("ERROR: Not enough memory to work out the probabilities\n");
+
+    free(heatmap);
+    render_reset(&screen); // the heatmap scrolls the screen
+}
+
+void hint_screen (Game * game)
+{
+    Board * map = &game->map;
+    Hint hint;
+    ms_hint(game, hint_milliseconds, &hint);
+    int number = hint.number_row >= 0 ? tile_count(map, tile_index(map, hint.number_row, hint.number_column)) : 0;
+    int other = hint.other_row >= 0 ? tile_count(map, tile_index(map, hint.other_row, hint.other_column)) : 0;
+
+    if (hint.kind == HINT_NONE)
+        printf("There's nothing left to open.\n\n");
+    else if (hint.kind == HINT_WRONG_MARKS && hint.number_row >= 0)
+        printf("The %d at R%d C%d has more marks around it than that, so one of them is wrong.\n\n",
+               number, hint.number_row + 1, hint.number_column + 1);
+    else if (hint.kind == HINT_WRONG_MARKS)
+        printf("No arrangement of the mines fits the map.  Is one of your marks wrong?\n\n");
+    else
+    {
+        printf("HINT:\n");
+        draw_map(map, NULL, tile_index(map, hint.row, hint.column));
+        printf("\nR%d C%d (highlighted) ", hint.row + 1, hint.column + 1);
+        if (hint.kind == HINT_SINGLE)
+            printf("is safe: the %d at R%d C%d already has all of its mines marked around it.\n",
+                   number, hint.number_row + 1, hint.number_column + 1);
+        else if (hint.kind == HINT_PAIR)
+            printf("is safe: the %d at R%d C%d and the %d at R%d C%d share hidden tiles, and between them\n"
+                   "they leave no room for a mine on it.\n",
+                   number, hint.number_row + 1, hint.number_column + 1, other, hint.other_row + 1, hint.other_column + 1);
+        else if (hint.kind == HINT_COUNTED)
+            printf("is safe: none of the ways the mines could be placed to fit every number puts one there.\n");
+        else if (hint.exact)
+            printf("can't be proven safe, but it's the tile least likely to be a mine (%.0f%% chance).\n", hint.chance * 100);
+        else if (hint.number_row >= 0)
+            printf("can't be proven safe, but it's the best found in time: the %d at R%d C%d leaves it about\n"
+                   "a %.0f%% chance of being a mine.\n", number, hint.number_row + 1, hint.number_column + 1, hint.chance * 100);
+        else
+            printf("can't be proven safe, but it's the best found in time: no number touches it, so it has about\n"
+                   "the average chance of being a mine (%.0f%%).\n", hint.chance * 100);
+        if (hint.out_of_time)
+            printf("(The hint ran out of time before trying every deduction.)\n");
+        printf("\n");
+    }
+    render_reset(&screen); // the hint scrolls the screen
+}
+
+void lose_screen (Game * game)
 {
     clear_screen();
 
     printf("KABOOM!!!!\n");
     printf("You stepped on a mine!\n\n");
     
-    printf("Score: %d\n", score);
-    printf("Time: %d seconds\n", time(NULL) - start_time);
+    printf("Score: %lld\n", game->score);
+    printf("Time: %ld seconds\n", (long)(time(NULL) - game->start_time));
+    printf("Seed: %llu\n", (unsigned long long)game->seed);
     
     printf("MAP:\n");
-    reveal_map(width, height, map);
-    draw_map(width, height, map);
+    reveal_map(&game->map);
+    draw_map(&game->map, NULL, -1);
 
     printf("\nBetter luck next time!\n");
-
-    if (!test_mode) exit(0);
 }
-void win_screen (int score, int start_time, int width, int height, int * map)
+void win_screen (Game * game)
 {
     clear_screen();
 
     printf("YOU WIN!!!\n");
     printf("Congratulations!  You made it through the mine field!\n\n");
 
-    printf("Score: %d\n", score);
-    printf("Time: %d seconds\n", time(NULL) - start_time);
+    printf("Score: %lld\n", game->score);
+    printf("Time: %ld seconds\n", (long)(time(NULL) - game->start_time));
+    printf("Seed: %llu\n", (unsigned long long)game->seed);
 
     printf("MAP:\n");
-    draw_map(width, height, map);
+    draw_map(&game->map, NULL, -1);
+}
+
+void save_screen (Game * game, const char * path)
+{
+    if (path == NULL) return;
+    if (ms_save(game, path) == SAVE_OK)
+        printf("Game saved.  Carry on with: --load %s\n", path);
+    else
+        printf("ERROR: Could not save the game to %s\n", path);
+}
+
+void replay_screen (const char * path)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Game * game;
+    JournalInfo info;
+    int result = journal_replay_file(path, &game, &info);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (result != 0)
+    {
+        printf("ERROR: Could not replay %s: %s\n", path, result == 1 ? "not a journal, or it doesn't fit its map" : "could not read it");
+        return;
+    }
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("%s\n\n", ms_status(game) == MS_WON ? "WON" : ms_status(game) == MS_LOST ? "LOST" : "STILL PLAYING");
+    printf("Moves: %lld (%lld marks)\n", info.moves, info.marks);
+    printf("Score: %lld\n", game->score);
+    printf("Remaining Tiles to Clear: %lld\n", game->free_positions);
+    printf("Time Played: %lld seconds\n", info.duration / 1000);
+    printf("Seed: %llu\n", (unsigned long long)game->seed);
+    printf("Replayed in %.3f ms (including making the map)\n", seconds * 1000);
+
+    // Only small maps are worth printing
+    if ((long long)game->width * game->height <= 10000)
+    {
+        printf("MAP:\n");
+        if (ms_status(game) == MS_LOST) reveal_map(&game->map);
+        draw_map(&game->map, NULL, -1);
+    }
+    ms_free(game);
+}
+
+void simulate_screen (int width, int height, int num_mines, Policy policy, long long games, uint64_t seed, int threads)
+{
+    const char * names[] = { "solver", "probability", "random" };
+    Simulation result;
+    if (simulate(width, height, num_mines, policy, games, seed, threads, &result) != 0)
+    {
+        printf("ERROR: Not enough memory to simulate the games\n");
+        return;
+    }
+
+    printf("%lld games of %d x %d with %d mines, played by the %s policy\n", result.games, width, height, num_mines, names[policy]);
+    printf("Won: %lld (%.2f%%, 95%% confidence interval %.2f%% - %.2f%%)\n",
+           result.wins, 100 * result.win_rate, 100 * result.low, 100 * result.high);
+    printf("Guesses: %.2f per game\n", (double)result.guesses / result.games);
+    printf("Time: %.2f seconds on %d threads (%.0f games/s)\n", result.seconds, result.threads, result.games / result.seconds);
+    printf("Seed: %llu\n", (unsigned long long)seed);
+}
+
+int script_screen (Game * game, FILE * in, long long * moves)
+{
+    char line[256];
+    int line_number = 0;
+    *moves = 0;
+    while (ms_status(game) == MS_PLAYING && fgets(line, sizeof(line), in) != NULL)
+    {
+        line_number ++;
+        char * c = line;
+        while (*c == ' ' || *c == '\t') c ++;
+        if (*c == '\n' || *c == '\r' || *c == '\0' || *c == '#') continue;
+        if (*c == 'q') return 1;
+
+        // Same "row, column" as when playing, but a space on its own is fine too
+        char option = *c;
+        int row, column, end = 0;
+        if ((option != 'g' && option != 'm' && option != 'c') || sscanf(c + 1, "%d%*[ ,]%d %n", &row, &column, &end) != 2 || c[1 + end] != '\0')
+        {
+            fprintf(stderr, "ERROR: Line %d of the script isn't \"g ROW, COLUMN\", \"m ROW, COLUMN\", \"c ROW, COLUMN\" or \"q\": %s", line_number, line);
+            return -1;
+        }
+        if (row < 1 || column < 1 || row > game->height || column > game->width)
+        {
+            fprintf(stderr, "ERROR: Line %d of the script is off the %d x %d map: %s", line_number, game->width, game->height, line);
+            return -1;
+        }
+
+        MsResult result = option == 'g' ? ms_reveal(game, row-1, column-1)
+                        : option == 'm' ? ms_mark(game, row-1, column-1) : ms_chord(game, row-1, column-1);
+        if (result == MS_NO_MEMORY)
+        {
+            fprintf(stderr, "ERROR: Ran out of memory on line %d of the script\n", line_number);
+            return -1;
+        }
+        (*moves) ++;
+    }
+    return 0;
+}
+
+int script_result (Game * game, long long moves)
+{
+    MsStatus status = ms_status(game);
+    printf("%s  Moves: %lld  Score: %lld  Remaining Tiles to Clear: %lld  Seed: %llu\n",
+           status == MS_WON ? "WON" : status == MS_LOST ? "LOST" : "STILL PLAYING",
+           moves, game->score, game->free_positions, (unsigned long long)game->seed);
+    return status == MS_WON ? 0 : status == MS_LOST ? 2 : 3;
+}
+
+const char * settings_error (int width, int height, int num_mines, _Bool simulation)
+{
+    if (width < MIN_WIDTH || width > MAX_WIDTH)
+        return "The number of columns must be between " STRINGIFY(MIN_WIDTH) " and " STRINGIFY(MAX_WIDTH);
+    if (height < MIN_HEIGHT || height > MAX_HEIGHT)
+        return "The number of rows must be between " STRINGIFY(MIN_HEIGHT) " and " STRINGIFY(MAX_HEIGHT);
+    if (simulation && (num_mines < MIN_MINES || num_mines > width * height - 9))
+        return "The number of mines must be between " STRINGIFY(MIN_MINES) " and the number of tiles - 9";
+    if (!simulation && (num_mines < MIN_MINES || num_mines > width * height / 9)) // same maximum as welcome_screen
+        return "The number of mines must be between " STRINGIFY(MIN_MINES) " and a ninth of the tiles";
+    return NULL;
 }
 
 void test_screen()
@@ -657,73 +1159,79 @@ void test_screen()
         test_mode = 1;
         int width = 5;
         int height = 4;
-        int map[height][width];
-        int score = 0;
-        time_t start_time = time(NULL);
+        Game game;
+        game.width = width;
+        game.height = height;
+        game.num_mines = 1;
+        game.score = 0;
+        game.free_positions = width * height - 1;
+        game.start_time = time(NULL);
+        game.status = MS_PLAYING;
+        game.mapping = NULL;
+        game.on_move = NULL;
+        game.history = NULL;
 
         printf("\nTesting the game:\n\n");
         // Test case 1: Win the game
         printf("Test Case 1: Winning the game\n\n");
-        printf("Initializing map with 0's...\n");
-        initialize_map(width, height, (int *)map);
+        printf("Initializing empty map...\n");
+        if (initialize_map(width, height, &game.map) != 0) return;
 
         printf("Adding mine to last position...\n");
-        map[height-1][width-1] = -9;
-        map[height-2][width-1] = -1;
-        map[height-2][width-2] = -1;
-        map[height-1][width-2] = -1;
+        set_bit(game.map.mines, tile_index(&game.map, height-1, width-1));
+        generate_map(&game.map);
 
         printf("Drawing hidden map...\n");
-        draw_map(width, height, (int *)map);
+        draw_map(&game.map, NULL, -1);
 
         printf("Guessing position (0, 0)...\n");
-        reveal_tile(1, 1, &score, start_time, width, height, (int *)map);
+        ms_reveal(&game, 1, 1);
 
         printf("Drawing new map...");
-        draw_map(width, height, (int *)map);
+        draw_map(&game.map, NULL, -1);
 
-        win_screen(score, start_time, width, height, (int *)map);
+        win_screen(&game);
 
         printf("Press ENTER to continue to next test");
         while (getchar() != '\n') continue;
 
         printf("\n\nTest Case 2: Losing the game\n\n");
         printf("Keeping the same map as before, resetting score and time...\n");
-        score = 0;
-        start_time = time(NULL);
+        game.score = 0;
+        game.start_time = time(NULL);
+        game.status = MS_PLAYING;
 
         printf("Guessing position (width-1, height-1)...\n");
-        reveal_tile(width-1,height-1, &score, start_time, width, height, (int *)map);
+        if (ms_reveal(&game, height-1, width-1) == MS_MINE)
+            lose_screen(&game);
 
         printf("Press ENTER to continue to next test");
         while (getchar() != '\n') continue;
 
         printf("\n\nTest Case 3: Too many mines\n");
-        printf("Randomly generating more mines than tiles...\n");
-        int free_positions = width * height;
-        int num_mines = width * height * 2;
-        int mine_positions[num_mines][2];
-        plant_mines(num_mines, width, height, mine_positions);
-
-        printf("Printing mine positions:\n");
-        for (int i = 0; i < num_mines; i ++) printf("Mine #%d: [%d, %d]\n", i, mine_positions[i][0], mine_positions[i][1]);
+        printf("Randomly planting more mines than tiles...\n");
+        free_map(&game.map);
+        if (initialize_map(width, height, &game.map) != 0) return;
+        rng_seed(&game.rng, rng_time_seed());
+        plant_mines(width * height * 2, &game.map, &game.rng);
 
         printf("Generating map:\n");
-        generate_map(width, height, 2*width*height, &free_positions, mine_positions, (int *)map);
+        generate_map(&game.map);
 
         printf("Revealing map:\n");
-        reveal_map(width, height, (int *)map);
+        reveal_map(&game.map);
 
         printf("Drawing map:\n");
-        draw_map(width, height, (int *)map);
+        draw_map(&game.map, NULL, -1);
 
-        printf("If some positions are not covered with mines, that's because mines are randomly placed and redundant mines are ingored, meaning there can be fewer mines that the user inputted.\n");
+        printf("Every position should be covered with a mine, since each tile can only hold one mine.\n");
 
         printf("Press ENTER to continue to next test");
         while (getchar() != '\n') continue;
 
         printf("Test Case 4: Invalid Input\n");
         printf("Now play the game in test mode (does not clear screen) with invalid input:\n\n");
+        free_map(&game.map);
 
     }
 }
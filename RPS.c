@@ -8,6 +8,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include <time.h>
+#include "rng.h"
 #define MAX_ASCII_LINE_LENGTH 256
 #define DEBUG_MODE false 
 
@@ -30,6 +31,9 @@ typedef struct
     char hand; // what the player throws (r=rock, p=paper, s=scissors)
 } Player;
 
+// Random numbers for the computer's hands (seeded in main, so --seed replays the same hands)
+static Rng rng;
+
 // welcome_screen -> void
 //      int *wins: pointer to variable with number of wins
 //      int *rounds: pointer to the variable with total number of rounds
@@ -172,9 +176,20 @@ void animate_ascii_sprite(int max_sprite_size, int num_frames, char sprite_array
 void get_sprite_array ( FILE *sprite, char separator_char, int max_sprite_size,
                         int num_frames, char sprite_array[num_frames][max_sprite_size]);
 
-int main(void)
+int main(int argc, char *argv[])
 {
-    srand(time(NULL));
+    uint64_t seed = rng_time_seed();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else
+        {
+            printf("Usage: %s [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+    rng_seed(&rng, seed);
 
     int wins = 0;
     int rounds = 0;
@@ -404,7 +419,7 @@ void shoot (char user_hand, Player comp, int *wins, int *rounds, int *ties)
     // Select the computer's hand
     if (comp.id == 1) // player1: randomly select r, p, or s
     {
-        switch (rand() % 3)
+        switch (rng_below(&rng, 3))
         {
             case 0:
                 comp.hand = 'r';
@@ -419,7 +434,7 @@ void shoot (char user_hand, Player comp, int *wins, int *rounds, int *ties)
     }
     else if (comp.id == 2)
     { 
-        switch (rand() % 4) // paper is chosen 2/4 times = 50%
+        switch (rng_below(&rng, 4)) // paper is chosen 2/4 times = 50%
         {
             case 0:
                 comp.hand = 'r';
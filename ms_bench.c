@@ -0,0 +1,1301 @@
+// Benchmarks for the Minesweeper engine
+// Compile: gcc -O2 -pthread ms_bench.c ms_engine.c ms_boxsum.c ms_solver.c ms_probability.c ms_noguess.c ms_render.c ms_journal.c ms_simulate.c -lm -o ms_bench
+// Run: ./ms_bench [plant|generate|striped|layout|frontier|reveal|solve|probability|hint|noguess|draw|replay|undo|simulate ...] [--json FILE] [--baseline FILE]
+//      (runs everything if no benchmark is named)
+//
+// plant, generate, striped, layout, frontier, reveal and draw are timed the same way: each case is
+// run WARMUP times without timing it, then at least MIN_SAMPLES times (and more, up to MAX_SAMPLES,
+// until SAMPLE_BUDGET is used up), and the percentiles of the runs are shown per unit of work
+// (e.g. per tile).
+//      --json FILE       also writes those results to FILE
+//      --baseline FILE   compares the median of every case with the same case in FILE (written by
+//                        an earlier --json run), and exits with 1 if any is more than
+//                        BASELINE_TOLERANCE percent slower
+//
+// plant: plant_mines in nanoseconds per mine, including the dense-map path, and checks that
+// exactly the requested number of mines was planted.
+// generate: generate_map's per-mine loop and the row-at-a-time box-sum (count_mines) with each
+// kernel, across map sizes and mine densities, in nanoseconds per tile.  Every kernel is checked
+// against the per-mine loop.
+// striped: count_striped on 1, 2, 4, ... threads (up to one per core, and at least 4) on big maps,
+// in nanoseconds per tile and the speedup over one thread.  Every run's counts have to be exactly
+// the same as the single-threaded counts.
+// layout: generate_map, count_mines and reveal_tile opening a whole map, on maps from 32x32 to
+// 10000x10000 stored row by row and in 8x8 blocks (LAYOUT_TILED), in nanoseconds per tile and,
+// where the CPU's counters can be read, last level cache misses per tile.
+// frontier: on a map that is open apart from 100 holes of 16x16 hidden tiles, finding the frontier
+// by looking at every tile against frontier_tiles, and solve_map from every open tile against
+// from the frontier (which have to solve the same tiles), in microseconds; and reveal_tile one
+// tile at a time with and without a tracked frontier, in nanoseconds per reveal.
+// reveal: reveal_tile opening a whole map from one click (the worst case for the flood fill), in
+// nanoseconds per tile opened, and opening every numbered tile one at a time in a random order,
+// in nanoseconds per reveal.
+// solve: boards solved per second by the deterministic solver at the beginner, intermediate and
+// expert settings, starting from an opening, and how many of them needed a guess.
+// probability: time mine_probabilities takes on boards where the solver got stuck.
+// hint: latency percentiles of ms_hint with a 50 ms budget, over games played by opening every
+// tile it points at (on a tracked frontier), and how often the hint was proven safe, a guess, or
+// ran out of time.
+// noguess: latency percentiles of ms_new_no_guess (using every core) for each board size.
+// draw: drawing a whole map to /dev/null, with a printf per tile (the way draw_map used to) and
+// with the renderer's single-write frame (render_map), in nanoseconds per tile and frames per
+// second.
+// replay: records a long game (random reveals of free tiles and marks of mines) in a journal,
+// plays it back with journal_replay and checks that it ends up exactly the same, in moves per
+// second and bytes per move.
+// undo: random moves like replay's kept in an undo history (ms_history_start), then every move
+// it kept undone and redone, which has to end up exactly the same; bytes of history per move and
+// per tile opened, and nanoseconds per move and per tile opened.
+// simulate: Monte Carlo games per second on 1, 2, 4, ... threads up to one per core, and the
+// speedup over one thread (the win rate has to come out the same on every number of threads).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include "ms_engine.h"
+#include "ms_solver.h"
+#include "ms_render.h"
+#include "ms_journal.h"
+#include "ms_simulate.h"
+
+#define REPEATS 5
+
+#define WARMUP 1                // runs of each case that aren't timed (to warm the caches and
+                                //   fault the memory in)
+#define MIN_SAMPLES 5           // fewest timed runs of each case
+#define MAX_SAMPLES 200         // most timed runs of each case
+#define SAMPLE_BUDGET 0.3e9     // nanoseconds after which no more than MIN_SAMPLES runs are done
+#define BASELINE_TOLERANCE 10   // percent slower than the baseline that counts as a regression
+
+// Current time in nanoseconds
+static double now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles (const void * a, const void * b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Value below which a fraction p of the sorted values fall
+static double percentile (const double * sorted, int count, double p)
+{
+    return sorted[(int)(p * (count - 1) + 0.5)];
+}
+
+
+/* Timing Harness */
+
+// Timed runs of one case
+//      Samples samples;
+//      start_samples(&samples);
+//      while (more_samples(&samples))
+//      {
+//          ... set up ...
+//          double start = now_ns();
+//          ... work ...
+//          add_sample(&samples, now_ns() - start);
+//      }
+//      report("name", "case", "ns/tile", &samples, tiles);
+typedef struct
+{
+    double times[MAX_SAMPLES];
+    int count;              // timed runs so far
+    int warmup;             // untimed runs so far
+    double started;
+} Samples;
+
+// Summary of one case, per unit of work
+typedef struct
+{
+    char name[32];          // e.g. "generate/sse2"
+    char params[32];        // e.g. "1000x1000 12%"
+    const char * unit;      // e.g. "ns/tile"
+    int runs;
+    double min, p50, p90, p99, max;
+} Result;
+
+// Every case reported so far (for --json and --baseline)
+static Result * results;
+static int num_results;
+
+static void start_samples (Samples * samples)
+{
+    samples->count = 0;
+    samples->warmup = 0;
+    samples->started = now_ns();
+}
+
+// Whether to do another run
+static int more_samples (const Samples * samples)
+{
+    if (samples->warmup < WARMUP || samples->count < MIN_SAMPLES) return 1;
+    return samples->count < MAX_SAMPLES && now_ns() - samples->started < SAMPLE_BUDGET;
+}
+
+static void add_sample (Samples * samples, double elapsed)
+{
+    if (samples->warmup < WARMUP)
+        samples->warmup ++;
+    else
+        samples->times[samples->count ++] = elapsed;
+}
+
+// Print the percentiles of a case per unit of work (e.g. per tile) and keep them
+// Returns the median time of a whole run in nanoseconds
+static double report (const char * name, const char * params, const char * unit, Samples * samples, double units)
+{
+    qsort(samples->times, samples->count, sizeof(double), compare_doubles);
+    Result * bigger = realloc(results, sizeof(Result) * (num_results + 1));
+    if (bigger == NULL) exit(1);
+    results = bigger;
+
+    Result * result = &results[num_results ++];
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    snprintf(result->params, sizeof(result->params), "%s", params);
+    result->unit = unit;
+    result->runs = samples->count;
+    result->min = samples->times[0] / units;
+    result->p50 = percentile(samples->times, samples->count, 0.5) / units;
+    result->p90 = percentile(samples->times, samples->count, 0.9) / units;
+    result->p99 = percentile(samples->times, samples->count, 0.99) / units;
+    result->max = samples->times[samples->count - 1] / units;
+
+    printf("%-16s %-16s p50 %9.3f  p90 %9.3f  p99 %9.3f  min %9.3f %-9s  %10.3f ms/run  (%d runs)\n",
+           name, params, result->p50, result->p90, result->p99, result->min, unit,
+           result->p50 * units / 1e6, result->runs);
+    return result->p50 * units;
+}
+
+// Write every result as JSON (one case per line, which is what compare_baseline reads)
+static void write_json (const char * path)
+{
+    FILE * file = fopen(path, "w");
+    if (file == NULL)
+    {
+        printf("ERROR: could not write %s\n", path);
+        return;
+    }
+    fprintf(file, "{\n  \"warmup\": %d, \"min_samples\": %d, \"max_samples\": %d,\n  \"results\": [\n",
+            WARMUP, MIN_SAMPLES, MAX_SAMPLES);
+    for (int i = 0; i < num_results; i ++)
+    {
+        Result * result = &results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"case\": \"%s\", \"unit\": \"%s\", \"runs\": %d, "
+                      "\"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+                result->name, result->params, result->unit, result->runs,
+                result->min, result->p50, result->p90, result->p99, result->max, i + 1 < num_results ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+// Find "key": "value" in a line of JSON
+// Returns 1 if it's there
+static int json_string (const char * line, const char * key, char * value, size_t size)
+{
+    char pattern[40];
+    snprintf(pattern, sizeof(pattern), "\"%s\": \"", key);
+    const char * start = strstr(line, pattern);
+    if (start == NULL) return 0;
+    start += strlen(pattern);
+    const char * end = strchr(start, '"');
+    if (end == NULL || (size_t)(end - start) >= size) return 0;
+    memcpy(value, start, end - start);
+    value[end - start] = '\0';
+    return 1;
+}
+
+// Find "key": number in a line of JSON
+// Returns 1 if it's there
+static int json_number (const char * line, const char * key, double * value)
+{
+    char pattern[40];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char * start = strstr(line, pattern);
+    if (start == NULL) return 0;
+    *value = strtod(start + strlen(pattern), NULL);
+    return 1;
+}
+
+// Compare the median of every case with the same case in a file written by write_json
+// Returns the number of cases more than BASELINE_TOLERANCE percent slower
+static int compare_baseline (const char * path)
+{
+    FILE * file = fopen(path, "r");
+    if (file == NULL)
+    {
+        printf("ERROR: could not read %s\n", path);
+        return 0;
+    }
+
+    printf("Compared with %s (median, + is slower)\n", path);
+    int slower = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        char name[32], params[32];
+        double p50;
+        if (!json_string(line, "name", name, sizeof(name)) || !json_string(line, "case", params, sizeof(params))
+            || !json_number(line, "p50", &p50) || p50 <= 0)
+            continue;
+
+        for (int i = 0; i < num_results; i ++)
+        {
+            Result * result = &results[i];
+            if (strcmp(result->name, name) != 0 || strcmp(result->params, params) != 0) continue;
+            double change = (result->p50 - p50) / p50 * 100;
+            printf("%-16s %-16s %9.3f -> %9.3f %-9s  %+6.1f%%%s\n", name, params, p50, result->p50, result->unit, change,
+                   change > BASELINE_TOLERANCE ? "  SLOWER" : change < -BASELINE_TOLERANCE ? "  faster" : "");
+            slower += change > BASELINE_TOLERANCE;
+        }
+    }
+    fclose(file);
+    return slower;
+}
+
+
+/* Benchmarks */
+
+// Number of mines in the mines plane
+static long long count_planted (const Board * map)
+{
+    size_t tiles = (size_t)map->width * map->height;
+    long long mines = 0;
+    for (size_t word = 0; word < (tiles + 63) / 64; word ++)
+        mines += __builtin_popcountll(map->mines[word]);
+    return mines;
+}
+
+// Time plant_mines for one map size and density
+static void bench_plant (int width, int height, double density)
+{
+    size_t tiles = (size_t)width * height;
+    long long num_mines = tiles * density;
+    Board map;
+    if (initialize_map(width, height, &map) != 0)
+    {
+        printf("%5d x %-5d  %4.0f%%  out of memory\n", width, height, density * 100);
+        exit(1);
+    }
+
+    Rng rng;
+    rng_seed(&rng, 1);
+    long long planted = 0;
+    Samples samples;
+    start_samples(&samples);
+    while (more_samples(&samples))
+    {
+        memset(map.mines, 0, (tiles + 63) / 64 * sizeof(uint64_t));
+        double start = now_ns();
+        plant_mines(num_mines, &map, &rng);
+        add_sample(&samples, now_ns() - start);
+        planted = count_planted(&map);
+    }
+
+    char params[32];
+    snprintf(params, sizeof(params), "%dx%d %g%%", width, height, density * 100);
+    report("plant_mines", params, "ns/mine", &samples, num_mines > 0 ? num_mines : 1);
+    if (planted != num_mines) printf("  WRONG NUMBER OF MINES\n");
+
+    free_map(&map);
+}
+
+// Time generate_map against count_mines with each kernel for one map size and density
+static void bench_generate (int width, int height, double density)
+{
+    size_t tiles = (size_t)width * height;
+    size_t words = (tiles + 63) / 64;
+    long long num_mines = tiles * density;
+    Board reference, map;
+    if (initialize_map(width, height, &reference) != 0 || initialize_map(width, height, &map) != 0)
+    {
+        printf("%5d x %-5d  %4.0f%%  out of memory\n", width, height, density * 100);
+        exit(1);
+    }
+    Rng rng;
+    rng_seed(&rng, 1);
+    plant_mines(num_mines, &reference, &rng);
+    memcpy(map.mines, reference.mines, words * sizeof(uint64_t));
+    char params[32];
+    snprintf(params, sizeof(params), "%dx%d %g%%", width, height, density * 100);
+
+    // Per-mine loop
+    Samples samples;
+    start_samples(&samples);
+    while (more_samples(&samples))
+    {
+        memset(reference.counts, 0, (tiles + 1) / 2);
+        double start = now_ns();
+        generate_map(&reference);
+        add_sample(&samples, now_ns() - start);
+    }
+    double loop = report("generate/loop", params, "ns/tile", &samples, tiles);
+
+    // Box-sum with each kernel
+    const char * names[] = { "generate/auto", "generate/scalar", "generate/sse2", "generate/avx2" };
+    for (CountKernel kernel = COUNT_SCALAR; kernel <= COUNT_AVX2; kernel ++)
+    {
+        CountKernel used = kernel;
+        start_samples(&samples);
+        while (more_samples(&samples) && used == kernel)
+        {
+            memset(map.counts, 0xFF, (tiles + 1) / 2); // make sure every count really is written
+            double start = now_ns();
+            used = count_mines(&map, kernel);
+            add_sample(&samples, now_ns() - start);
+        }
+        if (used != kernel)
+        {
+            printf("%-16s %-16s n/a on this CPU\n", names[kernel], params);
+            continue;
+        }
+
+        // Check the counts against the per-mine loop
+        int mismatch = 0;
+        for (size_t i = 0; i < tiles && !mismatch; i ++)
+            mismatch = tile_count(&map, i) != tile_count(&reference, i);
+
+        double box_sum = report(names[kernel], params, "ns/tile", &samples, tiles);
+        printf("%-16s %-16s %.1fx the per-mine loop%s\n", "", "", loop / box_sum, mismatch ? "  MISMATCH" : "");
+    }
+
+    free_map(&reference);
+    free_map(&map);
+}
+
+// Time reveal_tile for one map size and density
+static void bench_reveal (int width, int height, double density)
+{
+    size_t tiles = (size_t)width * height;
+    size_t words = (tiles + 63) / 64;
+    Board map;
+    if (initialize_map(width, height, &map) != 0)
+    {
+        printf("%5d x %-5d  %4.0f%%  out of memory\n", width, height, density * 100);
+        exit(1);
+    }
+    Rng rng;
+    rng_seed(&rng, 1);
+    plant_mines(tiles * density, &map, &rng);
+    count_mines(&map, COUNT_AUTO);
+    char params[32];
+    snprintf(params, sizeof(params), "%dx%d %g%%", width, height, density * 100);
+
+    // One huge opening: click the tile with no surrounding mines nearest the middle
+    size_t middle = tile_index(&map, height / 2, width / 2);
+    size_t start_tile = tiles;
+    for (size_t i = 0; i < tiles && start_tile == tiles; i ++)
+    {
+        size_t index = (middle + i) % tiles;
+        if (!test_bit(map.mines, index) && tile_count(&map, index) == 0) start_tile = index;
+    }
+    if (start_tile < tiles)
+    {
+        long long score = 0;
+        Samples samples;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memset(map.revealed, 0, words * sizeof(uint64_t));
+            score = 0;
+            double start = now_ns();
+            int row, column;
+            tile_position(&map, start_tile, &row, &column);
+            if (reveal_tile(column, row, &score, &map) != 0) exit(1);
+            add_sample(&samples, now_ns() - start);
+        }
+        report("reveal/opening", params, "ns/tile", &samples, score);
+    }
+
+    // Many small reveals: every numbered tile (up to a million of them) one at a time, in a
+    // random order, so none of them floods
+    size_t * order = malloc(sizeof(size_t) * (tiles < 1 << 20 ? tiles : 1 << 20));
+    if (order == NULL) exit(1);
+    size_t count = 0;
+    for (size_t index = 0; index < tiles && count < 1 << 20; index ++)
+        if (!test_bit(map.mines, index) && tile_count(&map, index) != 0) order[count ++] = index;
+    for (size_t i = count; i > 1; i --)
+    {
+        size_t j = rng_below(&rng, i);
+        size_t swap = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = swap;
+    }
+    if (count > 0)
+    {
+        Samples samples;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memset(map.revealed, 0, words * sizeof(uint64_t));
+            long long score = 0;
+            double start = now_ns();
+            for (size_t i = 0; i < count; i ++)
+            {
+                int row, column;
+                tile_position(&map, order[i], &row, &column);
+                reveal_tile(column, row, &score, &map);
+            }
+            add_sample(&samples, now_ns() - start);
+        }
+        report("reveal/small", params, "ns/reveal", &samples, count);
+    }
+
+    free(order);
+    free_map(&map);
+}
+
+// Open the first tile the way a player would be given an opening: the centre tile if it has
+// no surrounding mines, otherwise the first such tile (or the first free tile if there are none)
+// Returns 0, or -1 if the map is all mines
+static int open_start (Game * game)
+{
+    size_t tiles = (size_t)game->width * game->height;
+    size_t start = tile_index(&game->map, game->height / 2, game->width / 2);
+    if (test_bit(game->map.mines, start) || tile_count(&game->map, start) != 0)
+    {
+        size_t free_tile = tiles;
+        for (start = 0; start < tiles; start ++)
+        {
+            if (test_bit(game->map.mines, start)) continue;
+            if (free_tile == tiles) free_tile = start;
+            if (tile_count(&game->map, start) == 0) break;
+        }
+        if (start == tiles) start = free_tile;
+        if (start == tiles) return -1;
+    }
+    ms_reveal(game, start / game->width, start % game->width);
+    return 0;
+}
+
+// Time the solver on many boards with the same settings
+static void bench_solve (const char * name, int width, int height, long long num_mines, int boards)
+{
+    double total = 0;
+    int won = 0, guess = 0, other = 0;
+    for (int seed = 1; seed <= boards; seed ++)
+    {
+        Game * game = ms_new(width, height, num_mines, seed);
+        if (game == NULL || open_start(game) != 0)
+        {
+            printf("%-12s  could not set up board %d\n", name, seed);
+            exit(1);
+        }
+
+        double start = now_ns();
+        SolveResult result = ms_solve(game);
+        total += now_ns() - start;
+
+        if (result == SOLVE_WON) won ++;
+        else if (result == SOLVE_GUESS) guess ++;
+        else other ++;
+        ms_free(game);
+    }
+    printf("%-12s  %2d x %-2d %3lld mines  %9.0f boards/s  %6.2f us/board  won %5.1f%%  guess needed %5.1f%%%s\n",
+           name, width, height, num_mines, boards / (total / 1e9), total / boards / 1e3,
+           100.0 * won / boards, 100.0 * guess / boards, other ? "  SOLVER ERROR" : "");
+}
+
+// Time mine_probabilities on boards the solver got stuck on
+static void bench_probability (const char * name, int width, int height, long long num_mines, int boards)
+{
+    double * probability = malloc(sizeof(double) * width * height);
+    double total = 0, slowest = 0;
+    int timed = 0, failed = 0;
+    for (int seed = 1; seed <= boards; seed ++)
+    {
+        Game * game = ms_new(width, height, num_mines, seed);
+        if (game == NULL || probability == NULL || open_start(game) != 0)
+        {
+            printf("%-12s  could not set up board %d\n", name, seed);
+            exit(1);
+        }
+        if (ms_solve(game) == SOLVE_GUESS)
+        {
+            double start = now_ns();
+            failed += mine_probabilities(&game->map, game->num_mines, probability) != 0;
+            double elapsed = now_ns() - start;
+            total += elapsed;
+            if (elapsed > slowest) slowest = elapsed;
+            timed ++;
+        }
+        ms_free(game);
+    }
+    printf("%-12s  %2d x %-2d %3lld mines  %6d stuck boards  %8.2f us average  %8.2f us slowest%s\n",
+           name, width, height, num_mines, timed, timed ? total / timed / 1e3 : 0, slowest / 1e3, failed ? "  FAILED" : "");
+    free(probability);
+}
+
+// Time ms_hint over games played by following the hints, up to max_hints per game
+static void bench_hint (const char * name, int width, int height, long long num_mines, int boards, int max_hints)
+{
+    size_t capacity = (size_t)boards * max_hints;
+    double * latency = malloc(sizeof(double) * capacity);
+    if (latency == NULL) exit(1);
+    int count = 0, safe = 0, guesses = 0, out_of_time = 0, wrong = 0;
+    for (int seed = 1; seed <= boards; seed ++)
+    {
+        Game * game = ms_new(width, height, num_mines, seed);
+        if (game == NULL || open_start(game) != 0 || frontier_track(&game->map) != 0)
+        {
+            printf("%-12s  could not set up board %d\n", name, seed);
+            exit(1);
+        }
+        for (int i = 0; i < max_hints && ms_status(game) == MS_PLAYING; i ++)
+        {
+            Hint hint;
+            double start = now_ns();
+            ms_hint(game, 50, &hint);
+            latency[count ++] = now_ns() - start;
+            out_of_time += hint.out_of_time;
+            if (hint.kind == HINT_GUESS)
+                guesses ++;
+            else if (hint.kind == HINT_SINGLE || hint.kind == HINT_PAIR || hint.kind == HINT_COUNTED)
+                safe ++;
+            else
+                break;
+
+            // A tile that was proven safe has to be
+            MsResult result = ms_reveal(game, hint.row, hint.column);
+            wrong += result == MS_MINE && hint.kind != HINT_GUESS;
+        }
+        ms_free(game);
+    }
+    qsort(latency, count, sizeof(double), compare_doubles);
+    printf("%-12s  %4d x %-4d %6lld mines  %6d hints  p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms  safe %5.1f%%  guess %5.1f%%  out of time %5.1f%%%s\n",
+           name, width, height, num_mines, count, percentile(latency, count, 0.5) / 1e6, percentile(latency, count, 0.99) / 1e6,
+           latency[count - 1] / 1e6, 100.0 * safe / count, 100.0 * guesses / count, 100.0 * out_of_time / count, wrong ? "  WRONG" : "");
+    free(latency);
+}
+
+// Time ms_new_no_guess with the first move in the middle of the map
+static void bench_no_guess (const char * name, int width, int height, long long num_mines, int boards)
+{
+    double * latency = malloc(sizeof(double) * boards);
+    if (latency == NULL) exit(1);
+    int failed = 0;
+    for (int seed = 1; seed <= boards; seed ++)
+    {
+        double start = now_ns();
+        Game * game = ms_new_no_guess(width, height, num_mines, seed, height / 2, width / 2, 0);
+        latency[seed - 1] = now_ns() - start;
+        failed += game == NULL;
+        ms_free(game);
+    }
+    qsort(latency, boards, sizeof(double), compare_doubles);
+    printf("%-12s  %3d x %-3d %4lld mines  p50 %8.2f ms  p90 %8.2f ms  p99 %8.2f ms  max %8.2f ms%s\n",
+           name, width, height, num_mines, percentile(latency, boards, 0.5) / 1e6, percentile(latency, boards, 0.9) / 1e6,
+           percentile(latency, boards, 0.99) / 1e6, latency[boards - 1] / 1e6, failed ? "  FAILED" : "");
+    free(latency);
+}
+
+// The old draw_map: a printf per tile and two sprintfs per number
+static void draw_map_printf (FILE * out, const Board * map)
+{
+    for (int row = -1; row < map->height + 1; row ++)
+    {
+        for (int column = -1; column < map->width + 1; column ++)
+        {
+            if (row == -1 && column == -1)
+                fprintf(out, "    ");
+            else if (row == map->height && column == map->width)
+                fprintf(out, "+\n");
+            else if (column == map->width)
+                fprintf(out, "|\n");
+            else if (row == map->height)
+                fprintf(out, "----");
+            else if (row == -1 || column == -1)
+            {
+                char str[12];
+                sprintf(str, row == -1 ? "C%d" : "R%d", (row == -1 ? column : row) + 1);
+                fprintf(out, "%-4s", str);
+            }
+            else
+            {
+                size_t index = tile_index(map, row, column);
+                int count = tile_count(map, index);
+                if (test_bit(map->flags, index))
+                    fprintf(out, "?");
+                else if (!test_bit(map->revealed, index))
+                    fprintf(out, ".");
+                else if (test_bit(map->mines, index))
+                    fprintf(out, "#");
+                else if (count > 0)
+                    fprintf(out, "%d", count);
+                else
+                    fprintf(out, " ");
+                fprintf(out, "   ");
+            }
+        }
+    }
+}
+
+// Time drawing a part-played map both ways
+static void bench_draw (int width, int height)
+{
+    FILE * out = fopen("/dev/null", "w");
+    Game * game = ms_new(width, height, (long long)width * height * 15 / 100, 1);
+    if (out == NULL || game == NULL || open_start(game) != 0) exit(1);
+    for (int i = 0; i < 1000; i ++) ms_mark(game, (i * 7) % height, (i * 13) % width);
+    char params[32];
+    snprintf(params, sizeof(params), "%dx%d", width, height);
+
+    Renderer renderer;
+    render_init(&renderer, out);
+    double frame[2];
+    for (int way = 0; way < 2; way ++)
+    {
+        Samples samples;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            double start = now_ns();
+            if (way == 0)
+            {
+                draw_map_printf(out, &game->map);
+                fflush(out);
+            }
+            else
+                render_map(&renderer, &game->map, NULL, -1);
+            add_sample(&samples, now_ns() - start);
+        }
+        frame[way] = report(way == 0 ? "draw/printf" : "draw/write", params, "ns/tile", &samples, (double)width * height);
+    }
+    printf("%-16s %-16s %.1f fps -> %.1f fps (%.1fx)\n", "", "", 1e9 / frame[0], 1e9 / frame[1], frame[0] / frame[1]);
+
+    render_free(&renderer);
+    ms_free(game);
+    fclose(out);
+}
+
+// Record a game of random moves and time playing it back
+static void bench_replay (int width, int height, double density, long long moves)
+{
+    // Record (marks go on mines and reveals on free tiles, so the game lasts)
+    char * data = NULL;
+    size_t length = 0;
+    FILE * file = open_memstream(&data, &length);
+    Game * game = ms_new(width, height, (long long)(width * height * density), 1);
+    Journal journal;
+    if (file == NULL || game == NULL || journal_start(&journal, file, game, 0, 0, 0) != 0) exit(1);
+    Rng rng;
+    rng_seed(&rng, 2);
+    long long played = 0;
+    while (played < moves && ms_status(game) == MS_PLAYING)
+    {
+        int row = rng_below(&rng, height);
+        int column = rng_below(&rng, width);
+        if (test_bit(game->map.mines, tile_index(&game->map, row, column)))
+            ms_mark(game, row, column);
+        else
+            ms_reveal(game, row, column);
+        played ++;
+    }
+    fclose(file);
+
+    // Play it back (best of a few runs, including making the map)
+    double best = 0;
+    int same = 1;
+    JournalInfo info;
+    for (int repeat = 0; repeat < REPEATS; repeat ++)
+    {
+        Game * replay;
+        double start = now_ns();
+        if (journal_replay((unsigned char *)data, length, &replay, &info) != 0) exit(1);
+        double elapsed = now_ns() - start;
+        if (repeat == 0 || elapsed < best) best = elapsed;
+
+        size_t words = ((size_t)width * height + 63) / 64;
+        same = same && replay->score == game->score && replay->status == game->status
+            && memcmp(replay->map.revealed, game->map.revealed, words * 8) == 0
+            && memcmp(replay->map.flags, game->map.flags, words * 8) == 0;
+        ms_free(replay);
+    }
+    printf("%4d x %-4d  %8lld moves  %5.2f bytes/move  %8.3f ms  %6.2f M moves/s%s\n", width, height, info.moves,
+           (double)length / info.moves, best / 1e6, info.moves / (best / 1e9) / 1e6, same ? "" : "  DIFFERENT GAME");
+
+    free(data);
+    ms_free(game);
+}
+
+// Random moves (like bench_replay) kept in a history of max_bytes, then every move it kept undone
+// and redone
+static void bench_undo (int width, int height, double density, long long moves, size_t max_bytes)
+{
+    Game * game = ms_new(width, height, (long long)(width * height * density), 1);
+    if (game == NULL || frontier_track(&game->map) != 0 || ms_history_start(game, max_bytes) != 0) exit(1);
+    Rng rng;
+    rng_seed(&rng, 2);
+    long long played = 0;
+    while (played < moves && ms_status(game) == MS_PLAYING)
+    {
+        int row = rng_below(&rng, height);
+        int column = rng_below(&rng, width);
+        if (test_bit(game->map.mines, tile_index(&game->map, row, column)))
+            ms_mark(game, row, column);
+        else
+            ms_reveal(game, row, column);
+        played ++;
+    }
+
+    size_t words = map_words(&game->map);
+    uint64_t * revealed = malloc(words * 8 * 2);
+    if (revealed == NULL) exit(1);
+    uint64_t * flags = revealed + words;
+    memcpy(revealed, game->map.revealed, words * 8);
+    memcpy(flags, game->map.flags, words * 8);
+    long long score = game->score;
+    MsStatus status = game->status;
+    long long kept = game->history->undos;
+    size_t bytes = game->history->length;
+
+    double start = now_ns();
+    while (ms_undo(game) == MS_OK) continue;
+    double undo = now_ns() - start;
+    long long opened = score - game->score; // tiles the kept moves opened
+    start = now_ns();
+    while (ms_redo(game) == MS_OK) continue;
+    double redo = now_ns() - start;
+
+    int same = game->score == score && game->status == status && memcmp(game->map.revealed, revealed, words * 8) == 0
+            && memcmp(game->map.flags, flags, words * 8) == 0;
+    printf("%4d x %-4d  %8lld moves  %8lld kept  %6.2f bytes/move  %5.2f bytes/tile  undo %8.1f ns/move %5.1f ns/tile  redo %8.1f ns/move %5.1f ns/tile%s\n",
+           width, height, played, kept, (double)bytes / kept, (double)bytes / opened, undo / kept, undo / opened,
+           redo / kept, redo / opened, same ? "" : "  DIFFERENT GAME");
+
+    free(revealed);
+    ms_free(game);
+}
+
+// Counter of the hardware cache misses (last level) of this thread
+// Returns the counter, or -1 if there isn't one (e.g. in most virtual machines, or when
+// /proc/sys/kernel/perf_event_paranoid doesn't allow it)
+static int open_miss_counter (void)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+// Cache misses since the counter was last read (0 without a counter)
+static long long read_misses (int counter)
+{
+    long long misses = 0;
+    if (counter < 0 || read(counter, &misses, sizeof(misses)) != sizeof(misses)) return 0;
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    return misses;
+}
+
+// One layout's map for bench_layout
+static void layout_map (int width, int height, double density, BoardLayout layout, Board * map)
+{
+    if (initialize_map_layout(width, height, layout, map) != 0)
+    {
+        printf("%5d x %-5d  out of memory\n", width, height);
+        exit(1);
+    }
+    Rng rng;
+    rng_seed(&rng, 1);
+    plant_mines((size_t)width * height * density, map, &rng); // the same tiles in both layouts
+}
+
+// generate_map, count_mines and a whole-map reveal_tile on the same map row by row and in 8x8
+// blocks, in nanoseconds and cache misses per tile
+static void bench_layout (int width, int height)
+{
+    size_t tiles = (size_t)width * height;
+    const char * layouts[] = { "rows", "tiled" };
+    int counter = open_miss_counter();
+    if (counter >= 0) ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    char name[32], params[32];
+    snprintf(params, sizeof(params), "%dx%d", width, height);
+
+    for (BoardLayout layout = LAYOUT_ROWS; layout <= LAYOUT_TILED; layout ++)
+    {
+        Board map;
+        Samples samples;
+        long long misses;
+
+        // The per-mine loop at 5% mines, where a mine's rows above and below are the far accesses
+        layout_map(width, height, 0.05, layout, &map);
+        misses = 0;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memset(map.counts, 0, map_count_bytes(&map));
+            read_misses(counter);
+            double start = now_ns();
+            generate_map(&map);
+            add_sample(&samples, now_ns() - start);
+            misses += read_misses(counter);
+        }
+        snprintf(name, sizeof(name), "loop/%s", layouts[layout]);
+        report(name, params, "ns/tile", &samples, tiles);
+        if (counter >= 0) printf("%-16s %-16s %.4f cache misses/tile\n", "", "", (double)misses / (samples.warmup + samples.count) / tiles);
+        free_map(&map);
+
+        // The box-sum at 20% mines
+        layout_map(width, height, 0.2, layout, &map);
+        misses = 0;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            read_misses(counter);
+            double start = now_ns();
+            count_mines(&map, COUNT_AUTO);
+            add_sample(&samples, now_ns() - start);
+            misses += read_misses(counter);
+        }
+        snprintf(name, sizeof(name), "box-sum/%s", layouts[layout]);
+        report(name, params, "ns/tile", &samples, tiles);
+        if (counter >= 0) printf("%-16s %-16s %.4f cache misses/tile\n", "", "", (double)misses / (samples.warmup + samples.count) / tiles);
+        free_map(&map);
+
+        // One click opening a map without mines, which floods every tile
+        layout_map(width, height, 0, layout, &map);
+        misses = 0;
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memset(map.revealed, 0, map_words(&map) * sizeof(uint64_t));
+            long long score = 0;
+            read_misses(counter);
+            double start = now_ns();
+            if (reveal_tile(width / 2, height / 2, &score, &map) != 0 || score != (long long)tiles) exit(1);
+            add_sample(&samples, now_ns() - start);
+            misses += read_misses(counter);
+        }
+        snprintf(name, sizeof(name), "reveal/%s", layouts[layout]);
+        report(name, params, "ns/tile", &samples, tiles);
+        if (counter >= 0) printf("%-16s %-16s %.4f cache misses/tile\n", "", "", (double)misses / (samples.warmup + samples.count) / tiles);
+        free_map(&map);
+    }
+    if (counter >= 0) close(counter);
+}
+
+// A map whose free tiles are all open and whose mines are all marked, apart from square holes
+// of hidden tiles: what a big map looks like near the end of a game
+static void holes_map (int width, int height, int holes, Board * map)
+{
+    if (initialize_map(width, height, map) != 0)
+    {
+        printf("%5d x %-5d  out of memory\n", width, height);
+        exit(1);
+    }
+    Rng rng;
+    rng_seed(&rng, 1);
+    plant_mines((size_t)width * height * 0.15, map, &rng);
+    count_mines(map, COUNT_AUTO);
+
+    size_t words = map_words(map);
+    for (size_t word = 0; word < words; word ++)
+    {
+        map->revealed[word] = ~map->mines[word];
+        map->flags[word] = map->mines[word];
+    }
+    for (int hole = 0; hole < holes; hole ++)
+    {
+        int top = rng_below(&rng, height), left = rng_below(&rng, width);
+        for (int row = top; row < top + 16 && row < height; row ++)
+        {
+            for (int column = left; column < left + 16 && column < width; column ++)
+            {
+                clear_bit(map->revealed, tile_index(map, row, column));
+                clear_bit(map->flags, tile_index(map, row, column));
+            }
+        }
+    }
+}
+
+// The frontier found the way everything did before frontier_track: by looking at every tile
+// Returns the number of tiles on it
+static size_t scan_frontier (const Board * map)
+{
+    size_t found = 0;
+    for (int row = 0; row < map->height; row ++)
+    {
+        for (int column = 0; column < map->width; column ++)
+        {
+            size_t index = tile_index(map, row, column);
+            if (test_bit(map->revealed, index) || test_bit(map->flags, index)) continue;
+            int next_to_open = 0;
+            for (int i = -1; i <= 1 && !next_to_open; i ++)
+                for (int j = -1; j <= 1 && !next_to_open; j ++)
+                {
+                    int r = row + i, c = column + j;
+                    if (r < 0 || r >= map->height || c < 0 || c >= map->width) continue;
+                    size_t neighbor = tile_index(map, r, c);
+                    next_to_open = test_bit(map->revealed, neighbor) && !test_bit(map->mines, neighbor);
+                }
+            found += next_to_open;
+        }
+    }
+    return found;
+}
+
+// Finding the frontier and solving a nearly finished map by scanning the whole map against the
+// frontier index, and what keeping the index up to date adds to reveal_tile
+static void bench_frontier (int width, int height, int holes)
+{
+    size_t tiles = (size_t)width * height;
+    Board map;
+    holes_map(width, height, holes, &map);
+    char params[32];
+    snprintf(params, sizeof(params), "%dx%d %dh", width, height, holes);
+    if (frontier_track(&map) != 0) exit(1);
+
+    // Finding the frontier
+    Samples samples;
+    size_t scanned = 0, indexed = 0;
+    start_samples(&samples);
+    while (more_samples(&samples))
+    {
+        double start = now_ns();
+        scanned = scan_frontier(&map);
+        add_sample(&samples, now_ns() - start);
+    }
+    report("frontier/scan", params, "us", &samples, 1e3);
+    start_samples(&samples);
+    while (more_samples(&samples))
+    {
+        const size_t * list;
+        double start = now_ns();
+        if (frontier_tiles(&map, &list, &indexed) != 0) exit(1);
+        add_sample(&samples, now_ns() - start);
+    }
+    report("frontier/index", params, "us", &samples, 1e3);
+    printf("%-16s %-16s %zu tiles on the frontier%s\n", "", "", indexed, indexed != scanned ? "  MISMATCH" : "");
+
+    // Solving the holes, from every open tile and from the frontier
+    size_t words = map_words(&map);
+    uint64_t * saved = malloc(sizeof(uint64_t) * words * 2);
+    uint64_t * solved = malloc(sizeof(uint64_t) * words);
+    if (saved == NULL || solved == NULL) exit(1);
+    memcpy(saved, map.revealed, sizeof(uint64_t) * words);
+    memcpy(saved + words, map.flags, sizeof(uint64_t) * words);
+    const char * names[] = { "solve/scan", "solve/frontier" };
+    int different = 0;
+    for (int tracked = 0; tracked <= 1; tracked ++)
+    {
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memcpy(map.revealed, saved, sizeof(uint64_t) * words);
+            memcpy(map.flags, saved + words, sizeof(uint64_t) * words);
+            frontier_untrack(&map);
+            if (tracked && frontier_track(&map) != 0) exit(1);
+            long long score = 0;
+            double start = now_ns();
+            if (solve_map(&map, &score) != 0) exit(1);
+            add_sample(&samples, now_ns() - start);
+        }
+        report(names[tracked], params, "us", &samples, 1e3);
+        if (!tracked) memcpy(solved, map.revealed, sizeof(uint64_t) * words);
+        else different = memcmp(solved, map.revealed, sizeof(uint64_t) * words) != 0;
+    }
+    if (different) printf("%-16s %-16s DIFFERENT RESULT\n", "", "");
+    free(saved);
+    free(solved);
+    free_map(&map);
+
+    // Every free tile (up to a million of them) revealed one at a time in a random order, with
+    // and without the index
+    Rng rng;
+    rng_seed(&rng, 2);
+    Board fresh;
+    if (initialize_map(width, height, &fresh) != 0) exit(1);
+    plant_mines(tiles * 0.15, &fresh, &rng);
+    count_mines(&fresh, COUNT_AUTO);
+    size_t * order = malloc(sizeof(size_t) * (tiles < 1 << 20 ? tiles : 1 << 20));
+    if (order == NULL) exit(1);
+    size_t count = 0;
+    for (size_t index = 0; index < tiles && count < 1 << 20; index ++)
+        if (!test_bit(fresh.mines, index)) order[count ++] = index;
+    for (size_t i = count; i > 1; i --)
+    {
+        size_t j = rng_below(&rng, i);
+        size_t swap = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = swap;
+    }
+    const char * reveal_names[] = { "reveal/untracked", "reveal/tracked" };
+    for (int tracked = 0; tracked <= 1; tracked ++)
+    {
+        start_samples(&samples);
+        while (more_samples(&samples))
+        {
+            memset(fresh.revealed, 0, sizeof(uint64_t) * map_words(&fresh));
+            frontier_untrack(&fresh);
+            if (tracked && frontier_track(&fresh) != 0) exit(1);
+            long long score = 0;
+            double start = now_ns();
+            for (size_t i = 0; i < count; i ++)
+                if (reveal_tile(order[i] % width, order[i] / width, &score, &fresh) != 0) exit(1);
+            add_sample(&samples, now_ns() - start);
+        }
+        report(reveal_names[tracked], params, "ns/reveal", &samples, count);
+    }
+    free(order);
+    free_map(&fresh);
+}
+
+// Striped counting (count_striped) on 1, 2, 4, ... threads, checked byte for byte against
+// the single-threaded counts.  Always goes up to at least 4 threads so the stripe boundaries get
+// checked on small machines too.
+static void bench_striped (int width, int height, double density)
+{
+    size_t tiles = (size_t)width * height;
+    size_t bytes = (tiles + 1) / 2;
+    int box_sum = density * 16 >= 1; // same choice as ms_new
+    Board map;
+    uint8_t * reference = malloc(bytes);
+    if (initialize_map(width, height, &map) != 0 || reference == NULL)
+    {
+        printf("%5d x %-5d  %4.0f%%  out of memory\n", width, height, density * 100);
+        exit(1);
+    }
+    Rng rng;
+    rng_seed(&rng, 1);
+    plant_mines(tiles * density, &map, &rng);
+    if (!box_sum || count_mines(&map, COUNT_AUTO) == COUNT_AUTO) generate_map(&map);
+    memcpy(reference, map.counts, bytes);
+
+    char name[32], params[32];
+    snprintf(params, sizeof(params), "%dx%d %g%%", width, height, density * 100);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    long most = cores > 4 ? cores : 4;
+    double one_thread = 0;
+    for (long threads = 1; ; threads = threads * 2 < most ? threads * 2 : most)
+    {
+        Samples samples;
+        start_samples(&samples);
+        int mismatch = 0;
+        while (more_samples(&samples))
+        {
+            memset(map.counts, 0, bytes);
+            double start = now_ns();
+            count_striped(&map, box_sum, threads);
+            add_sample(&samples, now_ns() - start);
+            mismatch |= memcmp(map.counts, reference, bytes) != 0;
+        }
+        snprintf(name, sizeof(name), "striped/%ld", threads);
+        double time = report(name, params, "ns/tile", &samples, tiles);
+        if (threads == 1) one_thread = time;
+        printf("%-16s %-16s %s, speedup %.2f on %ld cores%s\n", "", "", box_sum ? "box-sum" : "per-mine loop",
+               one_thread / time, cores, mismatch ? "  MISMATCH" : "");
+        if (threads >= most) break;
+    }
+
+    free(reference);
+    free_map(&map);
+}
+
+// Simulate the same games on more and more threads
+static void bench_simulate (const char * name, int width, int height, long long num_mines, Policy policy, long long games)
+{
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    double one_thread = 0;
+    long long wins = -1;
+    for (long threads = 1; ; threads = threads * 2 < cores ? threads * 2 : cores)
+    {
+        Simulation result;
+        if (simulate(width, height, num_mines, policy, games, 1, threads, &result) != 0)
+        {
+            printf("%-12s  could not simulate\n", name);
+            exit(1);
+        }
+        double rate = result.games / result.seconds;
+        if (threads == 1) one_thread = rate;
+        printf("%-12s  %2d x %-2d %3lld mines  %3ld threads  %9.0f games/s  speedup %5.2f  won %5.2f%%%s\n",
+               name, width, height, num_mines, threads, rate, rate / one_thread, 100 * result.win_rate,
+               wins >= 0 && result.wins != wins ? "  DIFFERENT RESULT" : "");
+        wins = result.wins;
+        if (threads >= cores) break;
+    }
+}
+
+// Whether a benchmark was asked for (all of them are if none were named)
+static int wanted (const char * name, const char * const * only, int num_only)
+{
+    for (int i = 0; i < num_only; i ++)
+        if (strcmp(only[i], name) == 0) return 1;
+    return num_only == 0;
+}
+
+int main (int argc, char * argv[])
+{
+    const char * only[16];
+    int num_only = 0;
+    const char * json_path = NULL;
+    const char * baseline_path = NULL;
+    for (int i = 1; i < argc; i ++)
+    {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+            baseline_path = argv[++i];
+        else if (argv[i][0] != '-' && num_only < 16)
+            only[num_only ++] = argv[i];
+        else
+        {
+            printf("Usage: %s [plant|generate|striped|layout|frontier|reveal|solve|probability|hint|noguess|draw|replay|undo|simulate ...] [--json FILE] [--baseline FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int sizes[][2] = { { 30, 16 }, { 256, 256 }, { 1000, 1000 }, { 4000, 4000 }, { 10000, 10000 } };
+    double densities[] = { 0.01, 0.05, 0.12, 0.2, 0.3 };
+
+    if (wanted("plant", only, num_only))
+    {
+        printf("plant_mines\n");
+        double plant_densities[] = { 0.01, 0.12, 0.3, 0.6, 0.9 };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s ++)
+            for (size_t d = 0; d < sizeof(plant_densities) / sizeof(plant_densities[0]); d ++)
+                bench_plant(sizes[s][0], sizes[s][1], plant_densities[d]);
+        printf("\n");
+    }
+
+    if (wanted("generate", only, num_only))
+    {
+        printf("generate_map: per-mine loop vs count_mines box-sum\n");
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s ++)
+            for (size_t d = 0; d < sizeof(densities) / sizeof(densities[0]); d ++)
+                bench_generate(sizes[s][0], sizes[s][1], densities[d]);
+        printf("\n");
+    }
+
+    if (wanted("striped", only, num_only))
+    {
+        printf("count_striped: counting a stripe of rows per thread\n");
+        bench_striped(4000, 4000, 0.01);
+        bench_striped(4000, 4000, 0.12);
+        bench_striped(10000, 10000, 0.01);
+        bench_striped(10000, 10000, 0.12);
+        bench_striped(9999, 10001, 0.2); // odd width, so the stripes start on even rows
+        printf("\n");
+    }
+
+    if (wanted("layout", only, num_only))
+    {
+        int counter = open_miss_counter();
+        printf("layout: row by row against 8x8 blocks (BoardLayout)%s\n", counter < 0 ? ", no cache miss counter on this machine" : "");
+        if (counter >= 0) close(counter);
+        int layout_sizes[][2] = { { 32, 32 }, { 1000, 1000 }, { 4000, 4000 }, { 10000, 10000 } };
+        for (size_t s = 0; s < sizeof(layout_sizes) / sizeof(layout_sizes[0]); s ++)
+            bench_layout(layout_sizes[s][0], layout_sizes[s][1]);
+        printf("\n");
+    }
+
+    if (wanted("frontier", only, num_only))
+    {
+        printf("frontier: scanning the whole map against the frontier index (frontier_track)\n");
+        bench_frontier(1000, 1000, 100);
+        bench_frontier(4000, 4000, 100);
+        printf("\n");
+    }
+
+    if (wanted("reveal", only, num_only))
+    {
+        printf("reveal_tile: one click opening the whole map, and every numbered tile one at a time\n");
+        double reveal_densities[] = { 0, 0.05, 0.2 };
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s ++)
+            for (size_t d = 0; d < sizeof(reveal_densities) / sizeof(reveal_densities[0]); d ++)
+                bench_reveal(sizes[s][0], sizes[s][1], reveal_densities[d]);
+        printf("\n");
+    }
+
+    if (wanted("solve", only, num_only))
+    {
+        printf("ms_solve: deterministic solver from an opening (solver time only)\n");
+        bench_solve("beginner", 9, 9, 10, 100000);
+        bench_solve("intermediate", 16, 16, 40, 50000);
+        bench_solve("expert", 30, 16, 99, 20000);
+        printf("\n");
+    }
+
+    if (wanted("probability", only, num_only))
+    {
+        printf("mine_probabilities: exact frontier probabilities once the solver is stuck\n");
+        bench_probability("beginner", 9, 9, 10, 20000);
+        bench_probability("intermediate", 16, 16, 40, 20000);
+        bench_probability("expert", 30, 16, 99, 20000);
+        printf("\n");
+    }
+
+    if (wanted("hint", only, num_only))
+    {
+        printf("ms_hint: a safe tile (or the least likely to be a mine) within 50 ms, following the hints\n");
+        bench_hint("expert", 30, 16, 99, 200, 1000);
+        bench_hint("large", 100, 100, 1600, 5, 1000);
+        bench_hint("huge", 2000, 2000, 640000, 1, 200);
+        printf("\n");
+    }
+
+    if (wanted("noguess", only, num_only))
+    {
+        printf("ms_new_no_guess: time to a board that can be won without guessing (%ld threads)\n",
+               sysconf(_SC_NPROCESSORS_ONLN));
+        bench_no_guess("beginner", 9, 9, 10, 1000);
+        bench_no_guess("intermediate", 16, 16, 40, 1000);
+        bench_no_guess("expert", 30, 16, 99, 500);
+        bench_no_guess("large", 100, 100, 1600, 100);
+        printf("\n");
+    }
+
+    if (wanted("draw", only, num_only))
+    {
+        printf("draw_map: whole frames drawn to /dev/null\n");
+        bench_draw(30, 30);
+        bench_draw(1000, 1000);
+        printf("\n");
+    }
+
+    if (wanted("replay", only, num_only))
+    {
+        printf("journal_replay: recorded random moves played back (best of %d)\n", REPEATS);
+        bench_replay(30, 16, 0.2, 1000000);
+        bench_replay(1000, 1000, 0.15, 5000000);
+        bench_replay(4000, 4000, 0.15, 5000000);
+        printf("\n");
+    }
+
+    if (wanted("undo", only, num_only))
+    {
+        printf("ms_undo / ms_redo: every move kept in the history taken back and played again\n");
+        bench_undo(30, 16, 0.2, 1000000, 1 << 20);
+        bench_undo(1000, 1000, 0.15, 5000000, 64 << 20);
+        bench_undo(4000, 4000, 0.15, 5000000, 16 << 20);  // more moves than the cap holds
+        bench_undo(4000, 4000, 0, 1, 64 << 20);           // one click opening the whole map
+        printf("\n");
+    }
+
+    if (wanted("simulate", only, num_only))
+    {
+        printf("simulate: Monte Carlo win rate, work stealing across threads\n");
+        bench_simulate("expert", 30, 16, 99, POLICY_SOLVER, 20000);
+        bench_simulate("expert/prob", 30, 16, 99, POLICY_PROBABILITY, 5000);
+        printf("\n");
+    }
+
+    if (json_path != NULL) write_json(json_path);
+    int slower = baseline_path != NULL ? compare_baseline(baseline_path) : 0;
+    free(results);
+    return slower > 0;
+}
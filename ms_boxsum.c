@@ -0,0 +1,366 @@
+// Neighbour counts as a 3x3 box-sum over the mines plane (see count_mines in ms_engine.h)
+//
+// Instead of visiting the eight neighbours of every mine, each row of the map is worked out
+// in one go:
+//   1. the mine bits of the rows above, at and below it are expanded to one byte per tile
+//      (with a zero byte of padding on each side for the left/right edge),
+//   2. the three rows are added together (vertical sum),
+//   3. each tile adds up the vertical sums to its left, itself and its right and takes away
+//      its own mine (horizontal sum),
+//   4. the bytes are packed back into the 4-bit counts plane.
+// Steps 2-4 run 16 (SSE2) or 32 (AVX2) tiles at a time.  The kernel is chosen at runtime so
+// the same binary works on any x86-64 CPU; other CPUs use the scalar version.
+//
+// count_striped runs the same thing (or the per-mine loop) on a stripe of rows per thread.
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ms_engine.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// Padding bytes kept on both sides of every expanded row.  One is needed for the edges; the
+// rest lets expand_row write whole 8-byte blocks past the end of the row.
+#define ROW_PADDING 16
+
+// Spread the low 8 bits out to eight 0/1 bytes (bit i goes to byte i)
+static inline uint64_t expand_byte (uint64_t bits)
+{
+    uint64_t bytes = ((bits & 0xFF) * 0x0101010101010101ULL) & 0x8040201008040201ULL;
+    // Adding 0x7F sets the top bit of every non-zero byte (and never carries into the next byte)
+    return ((bytes + 0x7F7F7F7F7F7F7F7FULL) >> 7) & 0x0101010101010101ULL;
+}
+
+// Expand the mine bits of one row into 0/1 bytes (dst must have 8 bytes of room past width)
+static void expand_row (const Board * map, int row, uint8_t * dst)
+{
+    size_t words = map_words(map);
+    size_t start = tile_index(map, row, 0);
+
+    if (map->layout == LAYOUT_TILED)
+    {
+        // The row is one byte of each block across the map (the bits past the right edge are 0)
+        const uint64_t * blocks = map->mines + start / 64;
+        unsigned shift = (row & 7) * 8;
+        for (int column = 0; column < map->width; column += 8)
+        {
+            uint64_t bytes = expand_byte(blocks[column >> 3] >> shift);
+            memcpy(dst + column, &bytes, 8);
+        }
+        memset(dst + map->width, 0, 8);
+        return;
+    }
+
+    for (int column = 0; column < map->width; column += 8)
+    {
+        // Next 8 bits of the row, which may straddle two words of the plane
+        size_t bit = start + column;
+        size_t word = bit >> 6;
+        unsigned shift = bit & 63;
+        uint64_t bits = map->mines[word] >> shift;
+        if (shift > 56 && word + 1 < words) bits |= map->mines[word + 1] << (64 - shift);
+
+        uint64_t bytes = expand_byte(bits);
+        memcpy(dst + column, &bytes, 8);
+    }
+    // Bits past the end of the row belong to the next row
+    memset(dst + map->width, 0, 8);
+}
+
+// Vertical sum followed by the horizontal sum for tiles [from, to) of a row
+//   above, middle, below: expanded rows, where index 0 is the padding byte left of column 0
+//   sums: scratch row the same size as the expanded rows
+//   out: one count per tile
+static void sum_row_scalar (const uint8_t * above, const uint8_t * middle, const uint8_t * below,
+                            uint8_t * sums, uint8_t * out, int from, int to)
+{
+    for (int i = from; i < to + 2; i ++)
+        sums[i] = above[i] + middle[i] + below[i];
+    for (int i = from; i < to; i ++)
+        out[i] = sums[i] + sums[i + 1] + sums[i + 2] - middle[i + 1];
+}
+
+// Pack pairs of counts into bytes: dst[i] = out[2i] | out[2i+1] << 4
+static void pack_row_scalar (const uint8_t * out, uint8_t * dst, size_t from, size_t pairs)
+{
+    for (size_t i = from; i < pairs; i ++)
+        dst[i] = out[2 * i] | (out[2 * i + 1] << 4);
+}
+
+// Pack a row of counts into a tiled counts plane, where each block holds 8 of the row's counts
+// in 4 bytes (out must have 8 bytes of room past width)
+static void pack_row_tiled (const Board * map, int row, uint8_t * out)
+{
+    uint8_t * dst = map->counts + tile_index(map, row, 0) / 2;
+    memset(out + map->width, 0, 8); // the tiles past the right edge
+    for (int column = 0; column < map->width; column += 8)
+    {
+        for (int i = 0; i < 4; i ++) dst[i] = out[column + 2 * i] | (out[column + 2 * i + 1] << 4);
+        dst += 32; // next block
+    }
+}
+
+#ifdef HAVE_X86_KERNELS
+static void sum_row_sse2 (const uint8_t * above, const uint8_t * middle, const uint8_t * below,
+                          uint8_t * sums, uint8_t * out, int from, int to)
+{
+    int i = from;
+    for (; i + 16 <= to + 2; i += 16)
+    {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(above + i)),
+                                   _mm_loadu_si128((const __m128i *)(middle + i)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(below + i)));
+        _mm_storeu_si128((__m128i *)(sums + i), sum);
+    }
+    for (; i < to + 2; i ++)
+        sums[i] = above[i] + middle[i] + below[i];
+
+    for (i = from; i + 16 <= to; i += 16)
+    {
+        __m128i sum = _mm_add_epi8(_mm_loadu_si128((const __m128i *)(sums + i)),
+                                   _mm_loadu_si128((const __m128i *)(sums + i + 1)));
+        sum = _mm_add_epi8(sum, _mm_loadu_si128((const __m128i *)(sums + i + 2)));
+        sum = _mm_sub_epi8(sum, _mm_loadu_si128((const __m128i *)(middle + i + 1)));
+        _mm_storeu_si128((__m128i *)(out + i), sum);
+    }
+    sum_row_scalar(above, middle, below, sums, out, i, to);
+}
+
+static void pack_row_sse2 (const uint8_t * out, uint8_t * dst, size_t from, size_t pairs)
+{
+    const __m128i low_nibble = _mm_set1_epi16(0x00FF);
+    const __m128i high_nibble = _mm_set1_epi16(0x00F0);
+    size_t i = from;
+    for (; i + 16 <= pairs; i += 16)
+    {
+        // Each 16-bit lane holds a pair (first count in the low byte): move the second
+        // count down next to the first one and narrow the lanes back to bytes
+        __m128i a = _mm_loadu_si128((const __m128i *)(out + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(out + 2 * i + 16));
+        a = _mm_or_si128(_mm_and_si128(a, low_nibble), _mm_and_si128(_mm_srli_epi16(a, 4), high_nibble));
+        b = _mm_or_si128(_mm_and_si128(b, low_nibble), _mm_and_si128(_mm_srli_epi16(b, 4), high_nibble));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+    }
+    pack_row_scalar(out, dst, i, pairs);
+}
+
+__attribute__((target("avx2")))
+static void sum_row_avx2 (const uint8_t * above, const uint8_t * middle, const uint8_t * below,
+                          uint8_t * sums, uint8_t * out, int from, int to)
+{
+    int i = from;
+    for (; i + 32 <= to + 2; i += 32)
+    {
+        __m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(above + i)),
+                                      _mm256_loadu_si256((const __m256i *)(middle + i)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(below + i)));
+        _mm256_storeu_si256((__m256i *)(sums + i), sum);
+    }
+    for (; i < to + 2; i ++)
+        sums[i] = above[i] + middle[i] + below[i];
+
+    for (i = from; i + 32 <= to; i += 32)
+    {
+        __m256i sum = _mm256_add_epi8(_mm256_loadu_si256((const __m256i *)(sums + i)),
+                                      _mm256_loadu_si256((const __m256i *)(sums + i + 1)));
+        sum = _mm256_add_epi8(sum, _mm256_loadu_si256((const __m256i *)(sums + i + 2)));
+        sum = _mm256_sub_epi8(sum, _mm256_loadu_si256((const __m256i *)(middle + i + 1)));
+        _mm256_storeu_si256((__m256i *)(out + i), sum);
+    }
+    sum_row_scalar(above, middle, below, sums, out, i, to);
+}
+
+__attribute__((target("avx2")))
+static void pack_row_avx2 (const uint8_t * out, uint8_t * dst, size_t from, size_t pairs)
+{
+    const __m256i low_nibble = _mm256_set1_epi16(0x00FF);
+    const __m256i high_nibble = _mm256_set1_epi16(0x00F0);
+    size_t i = from;
+    for (; i + 32 <= pairs; i += 32)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(out + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(out + 2 * i + 32));
+        a = _mm256_or_si256(_mm256_and_si256(a, low_nibble), _mm256_and_si256(_mm256_srli_epi16(a, 4), high_nibble));
+        b = _mm256_or_si256(_mm256_and_si256(b, low_nibble), _mm256_and_si256(_mm256_srli_epi16(b, 4), high_nibble));
+        // packus works within each 128-bit half, so put the 64-bit blocks back in order
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst + i), packed);
+    }
+    pack_row_sse2(out, dst, i, pairs);
+}
+#endif
+
+// Pick the kernel to use (COUNT_AUTO picks the fastest one the CPU supports)
+static CountKernel choose_kernel (CountKernel kernel)
+{
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    int has_avx2 = __builtin_cpu_supports("avx2");
+    if (kernel == COUNT_AUTO) return has_avx2 ? COUNT_AVX2 : COUNT_SSE2;
+    if (kernel == COUNT_AVX2 && !has_avx2) return COUNT_SSE2;
+    return kernel;
+#else
+    (void)kernel;
+    return COUNT_SCALAR;
+#endif
+}
+
+// Box-sum of rows first_row up to (not including) end_row
+// Returns the kernel that was used, or COUNT_AUTO (before writing anything) if out of memory
+static CountKernel count_rows (Board * map, CountKernel kernel, int first_row, int end_row)
+{
+    int width = map->width;
+    int height = map->height;
+
+    kernel = choose_kernel(kernel);
+    void (*sum_row)(const uint8_t *, const uint8_t *, const uint8_t *, uint8_t *, uint8_t *, int, int) = sum_row_scalar;
+    void (*pack_row)(const uint8_t *, uint8_t *, size_t, size_t) = pack_row_scalar;
+#ifdef HAVE_X86_KERNELS
+    if (kernel == COUNT_SSE2)
+    {
+        sum_row = sum_row_sse2;
+        pack_row = pack_row_sse2;
+    }
+    else if (kernel == COUNT_AVX2)
+    {
+        sum_row = sum_row_avx2;
+        pack_row = pack_row_avx2;
+    }
+#endif
+
+    // Three expanded rows that get rotated as we go down the map, plus the scratch rows.
+    // Every row is padded on both sides (so row[-1] and row[width] exist and are 0).
+    size_t row_size = (size_t)width + 2 * ROW_PADDING;
+    uint8_t * buffer = calloc(row_size, 6);
+    if (buffer == NULL) return COUNT_AUTO;
+    uint8_t * above = buffer + ROW_PADDING;
+    uint8_t * middle = above + row_size;
+    uint8_t * below = middle + row_size;
+    uint8_t * sums = below + row_size;
+    uint8_t * out = sums + row_size;
+    uint8_t * zero = out + row_size; // stands in for the rows above the top and below the bottom
+
+    // A stripe that doesn't start at the top needs the row above it as well
+    if (first_row > 0) expand_row(map, first_row - 1, above);
+    expand_row(map, first_row, middle);
+    for (int row = first_row; row < end_row; row ++)
+    {
+        if (row + 1 < height) expand_row(map, row + 1, below);
+        const uint8_t * up = row > 0 ? above : zero;
+        const uint8_t * down = row + 1 < height ? below : zero;
+
+        // The sums include the padding byte left of column 0
+        sum_row(up - 1, middle - 1, down - 1, sums, out, 0, width);
+
+        // Pack into the counts plane.  A row can start or end half way through a byte, and
+        // that byte is shared with the row above/below, so those nibbles are merged in.
+        if (map->layout == LAYOUT_TILED)
+            pack_row_tiled(map, row, out);
+        else
+        {
+            size_t start = tile_index(map, row, 0);
+            uint8_t * dst = map->counts + start / 2;
+            const uint8_t * tiles = out;
+            size_t remaining = width;
+            if (start & 1)
+            {
+                *dst = (*dst & 0x0F) | (tiles[0] << 4);
+                dst ++;
+                tiles ++;
+                remaining --;
+            }
+            pack_row(tiles, dst, 0, remaining / 2);
+            if (remaining & 1)
+            {
+                dst += remaining / 2;
+                *dst = (*dst & 0xF0) | tiles[remaining - 1];
+            }
+        }
+
+        // Rotate the rows
+        uint8_t * recycled = above;
+        above = middle;
+        middle = below;
+        below = recycled;
+    }
+
+    free(buffer);
+    return kernel;
+}
+
+CountKernel count_mines (Board * map, CountKernel kernel)
+{
+    return count_rows(map, kernel, 0, map->height);
+}
+
+// One thread's stripe of the map
+typedef struct
+{
+    Board * map;
+    int box_sum;
+    int first_row;
+    int end_row;
+} Stripe;
+
+static void * count_stripe (void * data)
+{
+    Stripe * stripe = data;
+    if (stripe->first_row >= stripe->end_row) return NULL;
+    if (!stripe->box_sum || count_rows(stripe->map, COUNT_AUTO, stripe->first_row, stripe->end_row) == COUNT_AUTO)
+        generate_rows(stripe->map, stripe->first_row, stripe->end_row);
+    return NULL;
+}
+
+int count_striped (Board * map, int box_sum, int threads)
+{
+    int width = map->width;
+    int height = map->height;
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+    if (threads > height) threads = height;
+
+    Stripe * stripes = malloc(sizeof(Stripe) * threads);
+    pthread_t * workers = malloc(sizeof(pthread_t) * threads);
+    if (stripes == NULL || workers == NULL || threads == 1)
+    {
+        free(stripes);
+        free(workers);
+        Stripe whole = { map, box_sum, 0, height };
+        count_stripe(&whole);
+        return 1;
+    }
+
+    // Equal stripes, except that with an odd width a row only starts on a whole byte of the
+    // counts plane every other row, so the stripes start on even rows (in a tiled map every row
+    // of a block has its own bytes)
+    for (int i = 0; i < threads; i ++)
+    {
+        int first_row = (long long)height * i / threads;
+        int end_row = (long long)height * (i + 1) / threads;
+        if ((width & 1) && map->layout == LAYOUT_ROWS)
+        {
+            first_row &= ~1;
+            if (i + 1 < threads) end_row &= ~1;
+        }
+        stripes[i] = (Stripe){ map, box_sum, first_row, end_row };
+    }
+
+    // This thread counts the first stripe, and any stripes whose thread can't be started
+    int started = 1;
+    while (started < threads && pthread_create(&workers[started], NULL, count_stripe, &stripes[started]) == 0)
+        started ++;
+    for (int i = started; i < threads; i ++) count_stripe(&stripes[i]);
+    count_stripe(&stripes[0]);
+    for (int i = 1; i < started; i ++) pthread_join(workers[i], NULL);
+
+    free(stripes);
+    free(workers);
+    return started;
+}
@@ -0,0 +1,326 @@
+// Endless Minesweeper (see ms_endless.h)
+//
+// Chunks are kept in a hash table keyed by their position.  A chunk is made in two steps:
+//   1. its mines are planted as soon as anything needs them (from a seed made from the world's
+//      seed and the chunk's position, so it doesn't matter in which order chunks are made),
+//   2. its counts are only filled in when a tile in it is revealed, since the tiles on its
+//      edges need the mines of the eight chunks around it (which get made without counts).
+#include <stdlib.h>
+#include <string.h>
+#include "ms_endless.h"
+
+// Chunk a world row or column is in (rounding down for negative positions)
+static long long chunk_of (long long position)
+{
+    return position >= 0 ? position / CHUNK_SIZE : -((-position - 1) / CHUNK_SIZE) - 1;
+}
+
+// Seed of the chunk at (row, column)
+static uint64_t chunk_seed (uint64_t seed, long long row, long long column)
+{
+    uint64_t x = seed;
+    x = rng_splitmix64(&x) ^ (uint64_t)row;
+    x = rng_splitmix64(&x) ^ (uint64_t)column;
+    return rng_splitmix64(&x);
+}
+
+// Slot in the hash table to start looking for the chunk at (row, column)
+static size_t chunk_slot (const World * world, long long row, long long column)
+{
+    uint64_t x = (uint64_t)row * 0x9E3779B97F4A7C15ULL ^ (uint64_t)column;
+    return rng_splitmix64(&x) & (world->capacity - 1);
+}
+
+// The chunk at (row, column), or NULL if it hasn't been made
+static Chunk * find_chunk (const World * world, long long row, long long column)
+{
+    for (size_t slot = chunk_slot(world, row, column); world->chunks[slot] != NULL; slot = (slot + 1) & (world->capacity - 1))
+        if (world->chunks[slot]->row == row && world->chunks[slot]->column == column)
+            return world->chunks[slot];
+    return NULL;
+}
+
+// Put a chunk in the hash table, doubling the table when it is half full
+// Returns 0, or -1 if it runs out of memory
+static int add_chunk (World * world, Chunk * chunk)
+{
+    if ((world->num_chunks + 1) * 2 > world->capacity)
+    {
+        Chunk ** old = world->chunks;
+        size_t old_capacity = world->capacity;
+        Chunk ** bigger = calloc(old_capacity * 2, sizeof(Chunk *));
+        if (bigger == NULL) return -1;
+
+        world->chunks = bigger;
+        world->capacity = old_capacity * 2;
+        for (size_t i = 0; i < old_capacity; i ++)
+        {
+            if (old[i] == NULL) continue;
+            size_t slot = chunk_slot(world, old[i]->row, old[i]->column);
+            while (world->chunks[slot] != NULL) slot = (slot + 1) & (world->capacity - 1);
+            world->chunks[slot] = old[i];
+        }
+        free(old);
+    }
+
+    size_t slot = chunk_slot(world, chunk->row, chunk->column);
+    while (world->chunks[slot] != NULL) slot = (slot + 1) & (world->capacity - 1);
+    world->chunks[slot] = chunk;
+    world->num_chunks ++;
+    return 0;
+}
+
+// The chunk at (row, column) with its mines planted, making it if needed
+// Returns NULL if it runs out of memory
+static Chunk * make_chunk (World * world, long long row, long long column)
+{
+    Chunk * chunk = find_chunk(world, row, column);
+    if (chunk != NULL) return chunk;
+
+    chunk = malloc(sizeof(Chunk));
+    if (chunk == NULL) return NULL;
+    if (initialize_map(CHUNK_SIZE, CHUNK_SIZE, &chunk->map) != 0)
+    {
+        free(chunk);
+        return NULL;
+    }
+    chunk->row = row;
+    chunk->column = column;
+    chunk->counted = 0;
+
+    Rng rng;
+    rng_seed(&rng, chunk_seed(world->seed, row, column));
+    plant_mines(world->mines_per_chunk, &chunk->map, &rng);
+    if (row == 0 && column == 0) clear_around(&chunk->map, ENDLESS_START, ENDLESS_START, &rng);
+
+    if (add_chunk(world, chunk) != 0)
+    {
+        free_map(&chunk->map);
+        free(chunk);
+        return NULL;
+    }
+    return chunk;
+}
+
+// Fill in the counts of a chunk from the mines of the 3x3 chunks around it
+// Each row of a chunk is one word, so the neighbours to the left and right of every tile in a
+// row are the word shifted by one, with the end bit coming from the next chunk over.
+static void fill_counts (Chunk * chunk, Chunk * around[3][3])
+{
+    for (int row = 0; row < CHUNK_SIZE; row ++)
+    {
+        uint64_t west[3], centre[3], east[3]; // bit c: mine at column c - 1, c, c + 1
+        for (int i = 0; i < 3; i ++)
+        {
+            int chunk_row = 1;
+            int mine_row = row + i - 1;
+            if (mine_row < 0)
+            {
+                chunk_row = 0;
+                mine_row += CHUNK_SIZE;
+            }
+            else if (mine_row >= CHUNK_SIZE)
+            {
+                chunk_row = 2;
+                mine_row -= CHUNK_SIZE;
+            }
+
+            uint64_t mines = around[chunk_row][1]->map.mines[mine_row];
+            centre[i] = mines;
+            west[i] = mines << 1 | around[chunk_row][0]->map.mines[mine_row] >> 63;
+            east[i] = mines >> 1 | around[chunk_row][2]->map.mines[mine_row] << 63;
+        }
+
+        for (int column = 0; column < CHUNK_SIZE; column ++)
+        {
+            int count = ((west[0] >> column) & 1) + ((centre[0] >> column) & 1) + ((east[0] >> column) & 1)
+                      + ((west[1] >> column) & 1) + ((east[1] >> column) & 1)
+                      + ((west[2] >> column) & 1) + ((centre[2] >> column) & 1) + ((east[2] >> column) & 1);
+            size_t index = tile_index(&chunk->map, row, column);
+            chunk->map.counts[index >> 1] |= count << ((index & 1) * 4);
+        }
+    }
+}
+
+// The chunk at (row, column) with its counts filled in, making it (and the chunks around it) if needed
+// Returns NULL if it runs out of memory
+static Chunk * counted_chunk (World * world, long long row, long long column)
+{
+    Chunk * chunk = make_chunk(world, row, column);
+    if (chunk == NULL || chunk->counted) return chunk;
+
+    Chunk * around[3][3];
+    for (int i = 0; i < 3; i ++)
+    {
+        for (int j = 0; j < 3; j ++)
+        {
+            around[i][j] = make_chunk(world, row + i - 1, column + j - 1);
+            if (around[i][j] == NULL) return NULL;
+        }
+    }
+    fill_counts(chunk, around);
+    chunk->counted = 1;
+    return chunk;
+}
+
+World * world_new (uint64_t seed, double density)
+{
+    World * world = malloc(sizeof(World));
+    if (world == NULL) return NULL;
+
+    if (density < 0) density = 0;
+    if (density > 1) density = 1;
+    world->seed = seed;
+    world->mines_per_chunk = density * CHUNK_SIZE * CHUNK_SIZE + 0.5;
+    world->capacity = 64;
+    world->num_chunks = 0;
+    world->chunks = calloc(world->capacity, sizeof(Chunk *));
+    world->score = 0;
+    world->status = MS_PLAYING;
+    world->last_row = ENDLESS_START;
+    world->last_column = ENDLESS_START;
+    if (world->chunks == NULL || world_reveal(world, ENDLESS_START, ENDLESS_START) == MS_NO_MEMORY)
+    {
+        world_free(world);
+        return NULL;
+    }
+    return world;
+}
+
+void world_free (World * world)
+{
+    if (world == NULL) return;
+    for (size_t i = 0; world->chunks != NULL && i < world->capacity; i ++)
+    {
+        if (world->chunks[i] == NULL) continue;
+        free_map(&world->chunks[i]->map);
+        free(world->chunks[i]);
+    }
+    free(world->chunks);
+    free(world);
+}
+
+// Open a hidden tile and add one to the score
+// Returns 1 if the tile has no surrounding mines (so its neighbours have to be opened too)
+static int flip_world_tile (World * world, Chunk * chunk, size_t index)
+{
+    world->score ++;
+    set_bit(chunk->map.revealed, index);
+    clear_bit(chunk->map.flags, index);
+    return tile_count(&chunk->map, index) == 0;
+}
+
+MsResult world_reveal (World * world, long long row, long long column)
+{
+    if (world->status != MS_PLAYING) return MS_GAME_OVER;
+
+    Chunk * chunk = counted_chunk(world, chunk_of(row), chunk_of(column));
+    if (chunk == NULL) return MS_NO_MEMORY;
+    size_t index = tile_index(&chunk->map, row - chunk->row * CHUNK_SIZE, column - chunk->column * CHUNK_SIZE);
+    if (test_bit(chunk->map.mines, index))
+    {
+        world->status = MS_LOST;
+        return MS_MINE;
+    }
+    if (test_bit(chunk->map.revealed, index)) return MS_NO_CHANGE;
+    world->last_row = row;
+    world->last_column = column;
+
+    // Same queue of zero tiles as reveal_tile, except that the tiles are world positions and
+    // each neighbour is looked up in whichever chunk it's in
+    long long local_queue[256][2];
+    long long (*queue)[2] = local_queue;
+    size_t capacity = sizeof(local_queue) / sizeof(local_queue[0]);
+    size_t head = 0;
+    size_t count = 0;
+    long long old_score = world->score;
+    MsResult result = MS_OK;
+
+    if (flip_world_tile(world, chunk, index))
+    {
+        queue[0][0] = row;
+        queue[0][1] = column;
+        count = 1;
+    }
+
+    while (count > 0)
+    {
+        long long zero_row = queue[head][0];
+        long long zero_column = queue[head][1];
+        head = (head + 1) & (capacity - 1);
+        count --;
+
+        for (int i = -1; i <= 1 && result == MS_OK; i ++)
+        {
+            for (int j = -1; j <= 1; j ++)
+            {
+                long long neighbor_row = zero_row + i;
+                long long neighbor_column = zero_column + j;
+                long long chunk_row = chunk_of(neighbor_row);
+                long long chunk_column = chunk_of(neighbor_column);
+                if (chunk_row != chunk->row || chunk_column != chunk->column)
+                {
+                    chunk = counted_chunk(world, chunk_row, chunk_column);
+                    if (chunk == NULL)
+                    {
+                        result = MS_NO_MEMORY;
+                        count = 0;
+                        break;
+                    }
+                }
+
+                index = tile_index(&chunk->map, neighbor_row - chunk_row * CHUNK_SIZE, neighbor_column - chunk_column * CHUNK_SIZE);
+                if (test_bit(chunk->map.revealed, index) || !flip_world_tile(world, chunk, index)) continue;
+                if (world->score - old_score >= ENDLESS_MAX_OPENING) continue; // leave the rest of the opening closed
+
+                // Queue the new zero tile, doubling the queue if it's full
+                if (count == capacity)
+                {
+                    long long (*bigger)[2] = malloc(sizeof(long long[2]) * capacity * 2);
+                    if (bigger == NULL)
+                    {
+                        result = MS_NO_MEMORY;
+                        count = 0;
+                        break;
+                    }
+                    memcpy(bigger, queue + head, sizeof(long long[2]) * (capacity - head));
+                    memcpy(bigger + (capacity - head), queue, sizeof(long long[2]) * head);
+                    if (queue != local_queue) free(queue);
+                    queue = bigger;
+                    head = 0;
+                    capacity *= 2;
+                }
+                size_t tail = (head + count) & (capacity - 1);
+                queue[tail][0] = neighbor_row;
+                queue[tail][1] = neighbor_column;
+                count ++;
+            }
+        }
+    }
+
+    if (queue != local_queue) free(queue);
+    return result;
+}
+
+MsResult world_mark (World * world, long long row, long long column)
+{
+    if (world->status != MS_PLAYING) return MS_GAME_OVER;
+
+    Chunk * chunk = make_chunk(world, chunk_of(row), chunk_of(column));
+    if (chunk == NULL) return MS_NO_MEMORY;
+    int result = mark_tile(row - chunk->row * CHUNK_SIZE, column - chunk->column * CHUNK_SIZE, &chunk->map);
+    return result == 1 ? MS_NO_CHANGE : MS_OK;
+}
+
+WorldTile world_tile (const World * world, long long row, long long column, int * count)
+{
+    Chunk * chunk = find_chunk(world, chunk_of(row), chunk_of(column));
+    if (chunk == NULL) return WORLD_HIDDEN;
+
+    size_t index = tile_index(&chunk->map, row - chunk->row * CHUNK_SIZE, column - chunk->column * CHUNK_SIZE);
+    if (world->status == MS_LOST && test_bit(chunk->map.mines, index)) return WORLD_MINE;
+    if (test_bit(chunk->map.flags, index)) return WORLD_MARKED;
+    if (!test_bit(chunk->map.revealed, index)) return WORLD_HIDDEN;
+    *count = tile_count(&chunk->map, index);
+    return WORLD_OPEN;
+}
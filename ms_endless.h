@@ -0,0 +1,87 @@
+// Endless Minesweeper
+// The world has no edges: it is split into CHUNK_SIZE x CHUNK_SIZE chunks, and each chunk's
+// mines come from the seed and the chunk's position alone, so a chunk is only made when a move
+// first reaches it and the same seed always gives the same world.  Memory grows with the area
+// that has been explored, not with the size of the world.
+#ifndef MS_ENDLESS_H
+#define MS_ENDLESS_H
+#include "ms_engine.h"
+
+// Width and height of a chunk (one row of a chunk is one word of its planes)
+#define CHUNK_SIZE 64
+
+// Most tiles a single reveal opens (an opening on a very sparse world could go on forever)
+#define ENDLESS_MAX_OPENING (1 << 20)
+
+// The tile the world starts with already open (it and its neighbours never have mines)
+#define ENDLESS_START (CHUNK_SIZE / 2)
+
+// A CHUNK_SIZE x CHUNK_SIZE piece of the world
+typedef struct
+{
+    long long row;          // position of the chunk (world row / CHUNK_SIZE, rounded down)
+    long long column;
+    Board map;              // the chunk's tiles (tile (0, 0) is the chunk's top left corner)
+    int counted;            // whether the counts have been filled in yet (they need the
+                            // mines of the eight chunks around it)
+} Chunk;
+
+// An endless game
+typedef struct
+{
+    uint64_t seed;          // seed the world is generated from
+    int mines_per_chunk;    // every chunk has exactly this many mines
+    Chunk ** chunks;        // hash table of the chunks made so far (NULL = empty slot)
+    size_t capacity;        // size of the hash table (a power of two)
+    size_t num_chunks;      // number of chunks made so far
+    long long score;        // number of tiles overturned
+    MsStatus status;        // MS_PLAYING or MS_LOST (an endless game can't be won)
+    long long last_row;     // last tile revealed
+    long long last_column;
+} World;
+
+// What a tile of the world looks like to the player (see world_tile)
+typedef enum
+{
+    WORLD_HIDDEN = 0,
+    WORLD_MARKED,
+    WORLD_OPEN,             // open, with its count of surrounding mines
+    WORLD_MINE              // a mine (shown once the game is lost)
+} WorldTile;
+
+// world_new -> World *
+//   uint64_t seed: seed to generate the world from
+//   double density: fraction of the tiles that are mines (between 0 and 1)
+// Makes a new endless world and opens the tile at (ENDLESS_START, ENDLESS_START)
+// Returns NULL if it runs out of memory
+World * world_new (uint64_t seed, double density);
+
+// world_free
+//   World * world: world returned by world_new (may be NULL)
+// Frees the world and all of its chunks
+void world_free (World * world);
+
+// world_reveal -> MsResult
+//   World * world
+//   long long row, long long column: any tile of the world (negative is fine)
+// Overturns a tile like ms_reveal, and its neighbours if it has no surrounding mines, across
+// as many chunks as the opening reaches (up to ENDLESS_MAX_OPENING tiles).
+// Returns MS_MINE if the tile was a mine, MS_NO_CHANGE if it was already open.
+MsResult world_reveal (World * world, long long row, long long column);
+
+// world_mark -> MsResult
+//   World * world
+//   long long row, long long column
+// Marks a hidden tile as a potential mine, or unmarks it if it was already marked.
+// Returns MS_NO_CHANGE if the tile has already been revealed.
+MsResult world_mark (World * world, long long row, long long column);
+
+// world_tile -> WorldTile
+//   const World * world
+//   long long row, long long column
+//   int * count: set to the number of surrounding mines for WORLD_OPEN tiles
+// Looks at a tile without making its chunk (a tile in a chunk that hasn't been made is hidden).
+// Once the game is lost, the mines of the chunks that have been made are shown.
+WorldTile world_tile (const World * world, long long row, long long column, int * count);
+
+#endif
@@ -0,0 +1,1216 @@
+// Headless Minesweeper engine (see ms_engine.h)
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "ms_engine.h"
+
+
+/* Game Functions */
+
+// Allocate a game with an empty map and plant its mines (without counting them yet)
+static Game * new_game (int width, int height, long long num_mines, uint64_t seed)
+{
+    if (width <= 0 || height <= 0 || num_mines < 0) return NULL;
+    if (num_mines > (long long)width * height) num_mines = (long long)width * height;
+
+    // The map lives on the heap so its size is only limited by memory
+    Game * game = malloc(sizeof(Game));
+    if (game == NULL || initialize_map(width, height, &game->map) != 0)
+    {
+        free(game);
+        return NULL;
+    }
+
+    game->width = width;
+    game->height = height;
+    game->num_mines = num_mines;
+    game->score = 0;
+    game->free_positions = (long long)width * height - num_mines;
+    game->start_time = time(NULL);
+    game->status = MS_PLAYING;
+    game->seed = seed;
+    rng_seed(&game->rng, seed);
+    game->mapping = NULL;
+    game->mapping_size = 0;
+    game->on_move = NULL;
+    game->on_move_data = NULL;
+    game->history = NULL;
+
+    plant_mines(num_mines, &game->map, &game->rng);
+    return game;
+}
+
+// Fill in the counts of a freshly planted map
+static void count_game (Game * game)
+{
+    // The box-sum costs the same for any number of mines, so it only pays off once the
+    // map has a few percent of mines (see ms_bench)
+    long long tiles = (long long)game->width * game->height;
+    int box_sum = game->num_mines * 16 >= tiles;
+    if (tiles >= STRIPED_TILES)
+        count_striped(&game->map, box_sum, 0);
+    else if (!box_sum || count_mines(&game->map, COUNT_AUTO) == COUNT_AUTO)
+        generate_map(&game->map);
+}
+
+// Allocate a game and generate its map
+Game * ms_new (int width, int height, long long num_mines, uint64_t seed)
+{
+    Game * game = new_game(width, height, num_mines, seed);
+    if (game != NULL) count_game(game);
+    return game;
+}
+
+// Allocate a game whose first move is (row, column), and make that move
+Game * ms_new_at (int width, int height, long long num_mines, uint64_t seed, int row, int column)
+{
+    if (row < 0 || column < 0 || row >= height || column >= width) return NULL;
+
+    Game * game = new_game(width, height, num_mines, seed);
+    if (game == NULL) return NULL;
+    clear_around(&game->map, row, column, &game->rng);
+    count_game(game);
+
+    if (ms_reveal(game, row, column) == MS_NO_MEMORY)
+    {
+        ms_free(game);
+        return NULL;
+    }
+    return game;
+}
+
+void ms_free (Game * game)
+{
+    if (game == NULL) return;
+    ms_history_stop(game);
+    if (game->mapping != NULL) // the planes are part of a loaded save file
+    {
+        frontier_untrack(&game->map);
+        munmap(game->mapping, game->mapping_size);
+    }
+    else
+        free_map(&game->map);
+    free(game);
+}
+
+// Add a tile to the list of changes (if there is one)
+static void add_change (MsChanges * changes, size_t index)
+{
+    if (changes == NULL || changes->out_of_memory) return;
+    if (changes->count == changes->capacity)
+    {
+        size_t capacity = changes->capacity > 0 ? changes->capacity * 2 : 64;
+        size_t * bigger = realloc(changes->tiles, sizeof(size_t) * capacity);
+        if (bigger == NULL)
+        {
+            changes->out_of_memory = 1;
+            return;
+        }
+        changes->tiles = bigger;
+        changes->capacity = capacity;
+    }
+    changes->tiles[changes->count ++] = index;
+}
+
+// Most bytes a varint can take
+#define MAX_VARINT 10
+
+// Kinds of tile in a move of the history (see MsHistory)
+#define HISTORY_OPENED 0
+#define HISTORY_OPENED_MARKED 1
+#define HISTORY_MARKED 2
+#define HISTORY_MINE 3
+
+// Store a number as a varint
+// Returns the number of bytes used
+static int put_varint (uint8_t * out, uint64_t value)
+{
+    int length = 0;
+    while (value >= 0x80)
+    {
+        out[length ++] = value | 0x80;
+        value >>= 7;
+    }
+    out[length ++] = value;
+    return length;
+}
+
+// Byte of the history's ring at an offset from the start of its oldest record
+static inline uint8_t * ring_at (MsHistory * history, size_t offset)
+{
+    size_t position = history->first + offset;
+    if (position >= history->capacity) position -= history->capacity;
+    return &history->bytes[position];
+}
+
+// Read a varint from the ring at *offset, moving *offset past it.  Going backwards it reads the
+// reversed length at the end of a record, and leaves *offset at the start of it.
+static uint64_t ring_varint (MsHistory * history, size_t * offset, int backwards)
+{
+    uint64_t value = 0;
+    for (int shift = 0; ; shift += 7)
+    {
+        uint8_t byte = backwards ? *ring_at(history, -- *offset) : *ring_at(history, (*offset) ++);
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80) return value;
+    }
+}
+
+// Copy bytes into the ring from an offset on (wrapping around its end)
+static void ring_write (MsHistory * history, size_t offset, const uint8_t * data, size_t length)
+{
+    size_t position = (history->first + offset) % history->capacity;
+    size_t before_end = history->capacity - position < length ? history->capacity - position : length;
+    memcpy(history->bytes + position, data, before_end);
+    memcpy(history->bytes, data + before_end, length - before_end);
+}
+
+// Start recording a move (if the game keeps a history)
+static void history_begin (MsHistory * history)
+{
+    if (history == NULL) return;
+    history->move_length = 0;
+    history->previous = 0;
+    history->broken = 0;
+}
+
+// Add a tile to the move being recorded (if the game keeps a history)
+static void history_add (MsHistory * history, size_t index, int kind)
+{
+    if (history == NULL || history->broken) return;
+    if (history->move_capacity - history->move_length < MAX_VARINT)
+    {
+        // A move that won't fit in the ring is never kept, so there's no point growing past it
+        size_t capacity = history->move_capacity > 0 ? history->move_capacity * 2 : 64;
+        if (capacity > history->capacity) capacity = history->capacity;
+        uint8_t * bigger = capacity - history->move_length >= MAX_VARINT ? realloc(history->move, capacity) : NULL;
+        if (bigger == NULL)
+        {
+            history->broken = 1;
+            return;
+        }
+        history->move = bigger;
+        history->move_capacity = capacity;
+    }
+
+    int64_t delta = (int64_t)(index - history->previous);
+    uint64_t zigzag = (uint64_t)delta << 1 ^ (uint64_t)(delta >> 63);
+    history->move_length += put_varint(history->move + history->move_length, zigzag << 2 | kind);
+    history->previous = index;
+}
+
+// Forget the oldest move in the history
+static void history_forget_oldest (MsHistory * history)
+{
+    size_t offset = 0;
+    size_t length = ring_varint(history, &offset, 0);
+    size_t size = 2 * offset + length;
+    history->first = (history->first + size) % history->capacity;
+    history->length -= size;
+    history->done -= size;
+    history->undos --;
+}
+
+// Forget every move in the history
+static void history_forget_all (MsHistory * history)
+{
+    history->first = 0;
+    history->length = history->done = 0;
+    history->undos = history->redos = 0;
+}
+
+// Finish recording a move: keep it as the newest move that can be undone, unless it changed nothing
+static void history_end (MsHistory * history)
+{
+    if (history == NULL || (history->move_length == 0 && !history->broken)) return;
+
+    // A new move forgets the moves that were undone
+    history->length = history->done;
+    history->redos = 0;
+
+    uint8_t header[MAX_VARINT];
+    int header_length = put_varint(header, history->move_length);
+    size_t size = 2 * header_length + history->move_length;
+    if (history->broken || size > history->capacity)
+    {
+        // The move can't be undone, so neither can anything before it
+        history_forget_all(history);
+        return;
+    }
+    while (history->capacity - history->length < size) history_forget_oldest(history);
+
+    uint8_t trailer[MAX_VARINT];
+    for (int i = 0; i < header_length; i ++) trailer[i] = header[header_length - 1 - i];
+    ring_write(history, history->length, header, header_length);
+    ring_write(history, history->length + header_length, history->move, history->move_length);
+    ring_write(history, history->length + header_length + history->move_length, trailer, header_length);
+    history->length += size;
+    history->done = history->length;
+    history->undos ++;
+}
+
+int ms_history_start (Game * game, size_t max_bytes)
+{
+    if (game->history != NULL) return 0;
+    if (max_bytes == 0) return -1;
+    MsHistory * history = calloc(1, sizeof(MsHistory));
+    if (history == NULL) return -1;
+    history->bytes = malloc(max_bytes);
+    if (history->bytes == NULL)
+    {
+        free(history);
+        return -1;
+    }
+    history->capacity = max_bytes;
+    game->history = history;
+    return 0;
+}
+
+void ms_history_clear (Game * game)
+{
+    if (game->history != NULL) history_forget_all(game->history);
+}
+
+void ms_history_stop (Game * game)
+{
+    if (game->history == NULL) return;
+    free(game->history->bytes);
+    free(game->history->move);
+    free(game->history);
+    game->history = NULL;
+}
+
+static int open_tiles (int column, int row, long long * score, Board * map, MsChanges * changes, MsHistory * history);
+
+// ms_reveal, adding the tiles it opens to changes (if it isn't NULL)
+static MsResult reveal_move (Game * game, int row, int column, MsChanges * changes)
+{
+    if (game->status != MS_PLAYING) return MS_GAME_OVER;
+    if (row < 0 || column < 0 || row >= game->height || column >= game->width) return MS_OUT_OF_RANGE;
+    if (game->on_move != NULL) game->on_move(game->on_move_data, 0, row, column);
+
+    long long old_score = game->score;
+    int result = open_tiles(column, row, &game->score, &game->map, changes, game->history);
+    if (result == 1)
+    {
+        game->status = MS_LOST;
+        add_change(changes, tile_index(&game->map, row, column));
+        history_add(game->history, tile_index(&game->map, row, column), HISTORY_MINE);
+        return MS_MINE;
+    }
+
+    // Each overturned tile adds one to the score
+    game->free_positions -= game->score - old_score;
+    if (game->free_positions <= 0) game->status = MS_WON;
+
+    if (result < 0) return MS_NO_MEMORY;
+    return game->score == old_score ? MS_NO_CHANGE : MS_OK;
+}
+
+// ms_mark, adding the tile to changes (if it isn't NULL)
+static MsResult mark_move (Game * game, int row, int column, MsChanges * changes)
+{
+    if (game->status != MS_PLAYING) return MS_GAME_OVER;
+    if (game->on_move != NULL && row >= 0 && column >= 0 && row < game->height && column < game->width)
+        game->on_move(game->on_move_data, 1, row, column);
+
+    int result = mark_tile(row, column, &game->map);
+    if (result == -100) return MS_OUT_OF_RANGE;
+    if (result == 1) return MS_NO_CHANGE; // Tile has already been revealed
+
+    add_change(changes, tile_index(&game->map, row, column));
+    history_add(game->history, tile_index(&game->map, row, column), HISTORY_MARKED);
+    return MS_OK;
+}
+
+// ms_chord, adding the tiles it opens to changes (if it isn't NULL)
+static MsResult chord_move (Game * game, int row, int column, MsChanges * changes)
+{
+    if (game->status != MS_PLAYING) return MS_GAME_OVER;
+    if (row < 0 || column < 0 || row >= game->height || column >= game->width) return MS_OUT_OF_RANGE;
+
+    Board * map = &game->map;
+    size_t index = tile_index(map, row, column);
+    int count = tile_count(map, index);
+    if (!test_bit(map->revealed, index) || test_bit(map->mines, index) || count == 0) return MS_NO_CHANGE;
+
+    int marked = 0;
+    for (int i = -1; i <= 1; i ++)
+        for (int j = -1; j <= 1; j ++)
+            if (row + i >= 0 && row + i < game->height && column + j >= 0 && column + j < game->width)
+                marked += test_bit(map->flags, tile_index(map, row + i, column + j));
+    if (marked != count) return MS_NO_CHANGE;
+
+    // Each neighbour is revealed as its own move, so a journal records a chord as the reveals it
+    // is made of
+    MsResult result = MS_NO_CHANGE;
+    for (int i = -1; i <= 1; i ++)
+    {
+        for (int j = -1; j <= 1; j ++)
+        {
+            int neighbor_row = row + i, neighbor_column = column + j;
+            if (neighbor_row < 0 || neighbor_row >= game->height || neighbor_column < 0 || neighbor_column >= game->width) continue;
+            size_t neighbor = tile_index(map, neighbor_row, neighbor_column);
+            if (test_bit(map->revealed, neighbor) || test_bit(map->flags, neighbor)) continue;
+
+            MsResult move = reveal_move(game, neighbor_row, neighbor_column, changes);
+            if (move == MS_MINE || move == MS_NO_MEMORY) return move;
+            if (move == MS_OK) result = MS_OK;
+        }
+    }
+    return result;
+}
+
+// Play one move, keeping it in the game's history (if it has one) so it can be undone as a whole
+static MsResult play_move (Game * game, MsMoveType type, int row, int column, MsChanges * changes)
+{
+    history_begin(game->history);
+    MsResult result = type == MS_MOVE_MARK ? mark_move(game, row, column, changes)
+                    : type == MS_MOVE_CHORD ? chord_move(game, row, column, changes)
+                    : reveal_move(game, row, column, changes);
+    history_end(game->history);
+    return result;
+}
+
+MsResult ms_reveal (Game * game, int row, int column)
+{
+    return play_move(game, MS_MOVE_REVEAL, row, column, NULL);
+}
+
+MsResult ms_mark (Game * game, int row, int column)
+{
+    return play_move(game, MS_MOVE_MARK, row, column, NULL);
+}
+
+MsResult ms_chord (Game * game, int row, int column)
+{
+    return play_move(game, MS_MOVE_CHORD, row, column, NULL);
+}
+
+static int compare_tiles (const void * a, const void * b)
+{
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+MsResult ms_apply (Game * game, const MsMove * moves, size_t count, MsChanges * changes)
+{
+    if (changes != NULL)
+    {
+        changes->count = 0;
+        changes->moves = 0;
+        changes->out_of_memory = 0;
+    }
+    if (game->status != MS_PLAYING) return MS_GAME_OVER;
+
+    MsResult result = MS_NO_CHANGE;
+    for (size_t i = 0; i < count && game->status == MS_PLAYING; i ++)
+    {
+        const MsMove * move = &moves[i];
+        MsResult played = play_move(game, move->type, move->row, move->column, changes);
+        if (played == MS_OUT_OF_RANGE)
+        {
+            result = played;
+            break;
+        }
+        if (changes != NULL) changes->moves ++;
+        if (played == MS_MINE || played == MS_NO_MEMORY)
+        {
+            result = played;
+            break;
+        }
+        if (played == MS_OK) result = MS_OK;
+    }
+
+    if (changes != NULL && changes->out_of_memory) return MS_NO_MEMORY; // the moves were still played
+
+    // A tile can be in the list more than once (e.g. marked and then unmarked), so sort the list
+    // and keep one of each
+    if (changes != NULL && changes->count > 1)
+    {
+        qsort(changes->tiles, changes->count, sizeof(size_t), compare_tiles);
+        size_t kept = 1;
+        for (size_t i = 1; i < changes->count; i ++)
+            if (changes->tiles[i] != changes->tiles[kept - 1]) changes->tiles[kept ++] = changes->tiles[i];
+        changes->count = kept;
+    }
+    return result;
+}
+
+void ms_changes_free (MsChanges * changes)
+{
+    free(changes->tiles);
+    changes->tiles = NULL;
+    changes->count = 0;
+    changes->capacity = 0;
+    changes->moves = 0;
+    changes->out_of_memory = 0;
+}
+
+MsStatus ms_status (const Game * game)
+{
+    return game->status;
+}
+
+
+/* Map Functions */
+
+// Allocate the planes with every tile hidden, unmarked and without mines
+int initialize_map (int width, int height, Board * map)
+{
+    return initialize_map_layout(width, height, LAYOUT_ROWS, map);
+}
+
+int initialize_map_layout (int width, int height, BoardLayout layout, Board * map)
+{
+    map->width = width;
+    map->height = height;
+    map->layout = layout;
+    map->frontier = NULL;
+
+    size_t words = map_words(map);
+    map->mines = calloc(words, sizeof(uint64_t));
+    map->revealed = calloc(words, sizeof(uint64_t));
+    map->flags = calloc(words, sizeof(uint64_t));
+    map->counts = calloc(map_count_bytes(map), 1);
+    if (map->mines == NULL || map->revealed == NULL || map->flags == NULL || map->counts == NULL)
+    {
+        free_map(map);
+        return -1;
+    }
+    return 0;
+}
+
+size_t map_words (const Board * map)
+{
+    if (map->layout == LAYOUT_TILED)
+        return (size_t)((map->width + 7) >> 3) * ((map->height + 7) >> 3);
+    return ((size_t)map->width * map->height + 63) / 64;
+}
+
+size_t map_count_bytes (const Board * map)
+{
+    if (map->layout == LAYOUT_TILED) return map_words(map) * 32;
+    return ((size_t)map->width * map->height + 1) / 2;
+}
+
+void free_map (Board * map)
+{
+    frontier_untrack(map);
+    free(map->mines);
+    free(map->revealed);
+    free(map->flags);
+    free(map->counts);
+    map->mines = map->revealed = map->flags = NULL;
+    map->counts = NULL;
+}
+
+// Position in the planes of the n-th tile counting row by row (the same as n in LAYOUT_ROWS)
+static inline size_t nth_tile (const Board * map, uint64_t n)
+{
+    if (map->layout == LAYOUT_TILED) return tile_index(map, n / map->width, n % map->width);
+    return n;
+}
+
+// Pick k distinct tiles out of the first n with Floyd's algorithm and set their bits in plane
+// (or clear them if value is 0).  Tiles that have already been picked are recognised by
+// their bit, so there are exactly k random draws and no retries for duplicates.  The tiles are
+// counted row by row whatever the layout, so a seed gives the same map in any layout.
+static void pick_tiles (const Board * map, uint64_t * plane, uint64_t n, uint64_t k, int value, Rng * rng)
+{
+    for (uint64_t j = n - k; j < n; j ++)
+    {
+        // j can't have been picked yet, since everything picked so far is below j
+        size_t tile = nth_tile(map, rng_below(rng, j + 1));
+        if (test_bit(plane, tile) == value) tile = nth_tile(map, j);
+
+        if (value) set_bit(plane, tile);
+        else clear_bit(plane, tile);
+    }
+}
+
+// Set the bit of every tile of the map in plane (and none of the bits past the edges)
+static void fill_plane (const Board * map, uint64_t * plane)
+{
+    size_t words = map_words(map);
+    if (map->layout == LAYOUT_TILED)
+    {
+        // Every block is full apart from those on the right and bottom edges
+        size_t blocks_across = (map->width + 7) >> 3;
+        for (size_t block = 0; block < words; block ++)
+        {
+            int rows = map->height - (int)(block / blocks_across) * 8;
+            int columns = map->width - (int)(block % blocks_across) * 8;
+            uint64_t row_bits = columns >= 8 ? 0xFF : ((uint64_t)1 << columns) - 1;
+            uint64_t bits = 0;
+            for (int row = 0; row < rows && row < 8; row ++) bits |= row_bits << (row * 8);
+            plane[block] = bits;
+        }
+        return;
+    }
+
+    uint64_t tiles = (uint64_t)map->width * map->height;
+    memset(plane, 0xFF, words * sizeof(uint64_t));
+    if (tiles % 64) plane[words - 1] = ((uint64_t)1 << (tiles % 64)) - 1;
+}
+
+// Plant exactly num mines on distinct tiles
+void plant_mines (long long num, Board * map, Rng * rng)
+{
+    uint64_t tiles = (uint64_t)map->width * map->height;
+    if (num <= 0) return;
+    if ((uint64_t)num > tiles) num = tiles;
+
+    if ((uint64_t)num <= tiles / 2)
+    {
+        pick_tiles(map, map->mines, tiles, num, 1, rng);
+    }
+    else
+    {
+        // Dense map: cover every tile with mines and pick the (fewer) tiles that stay free
+        fill_plane(map, map->mines);
+        pick_tiles(map, map->mines, tiles, tiles - num, 0, rng);
+    }
+}
+
+// Move the mines on and around a tile to random free tiles elsewhere
+void clear_around (Board * map, int row, int column, Rng * rng)
+{
+    uint64_t tiles = (uint64_t)map->width * map->height;
+    size_t words = map_words(map);
+
+    // Free tiles outside of the 3x3 block, which is where the mines can go
+    long long free_tiles = tiles;
+    for (size_t word = 0; word < words; word ++) free_tiles -= __builtin_popcountll(map->mines[word]);
+    for (int i = -1; i <= 1; i ++)
+        for (int j = -1; j <= 1; j ++)
+            if (row + i >= 0 && row + i < map->height && column + j >= 0 && column + j < map->width)
+                free_tiles -= !test_bit(map->mines, tile_index(map, row + i, column + j));
+
+    // Every free tile outside of the block is equally likely, so the map stays uniformly random
+    // among the maps with no mines in the block
+    for (int i = -1; i <= 1; i ++)
+    {
+        for (int j = -1; j <= 1; j ++)
+        {
+            int mine_row = row + i;
+            int mine_column = column + j;
+            if (mine_row < 0 || mine_row >= map->height || mine_column < 0 || mine_column >= map->width) continue;
+            size_t index = tile_index(map, mine_row, mine_column);
+            if (!test_bit(map->mines, index)) continue;
+            if (free_tiles == 0) return; // too many mines to clear the whole block
+
+            uint64_t tile;
+            int tile_row, tile_column;
+            do
+            {
+                uint64_t n = rng_below(rng, tiles);
+                tile_row = n / map->width;
+                tile_column = n % map->width;
+                tile = tile_index(map, tile_row, tile_column);
+            } while (test_bit(map->mines, tile) || (abs(tile_row - row) <= 1 && abs(tile_column - column) <= 1));
+
+            set_bit(map->mines, tile);
+            clear_bit(map->mines, index);
+            free_tiles --;
+        }
+    }
+}
+
+// Count the mines surrounding each tile by visiting every mine (assumes the counts are all 0)
+void generate_map (Board * map)
+{
+    generate_rows(map, 0, map->height);
+}
+
+// Same, but only the counts of rows first_row to end_row - 1 (see count_striped)
+void generate_rows (Board * map, int first_row, int end_row)
+{
+    int width = map->width;
+    int height = map->height;
+
+    // The mines in the rows just above and below add to the rows' counts too.  The words from
+    // the first tile of those rows to the last one hold all of their mines (in either layout).
+    int first_mine_row = first_row > 0 ? first_row - 1 : 0;
+    int end_mine_row = end_row < height ? end_row + 1 : height;
+    size_t first_word = tile_index(map, first_mine_row, 0) / 64;
+    size_t end_word = tile_index(map, end_mine_row - 1, width - 1) / 64 + 1;
+
+    // For each mine, add one to the count of the surrounding tiles
+    for (size_t word = first_word; word < end_word; word ++)
+    {
+        for (uint64_t bits = map->mines[word]; bits != 0; bits &= bits - 1)
+        {
+            // Position of the lowest mine left in this word
+            int mine_row, mine_column;
+            tile_position(map, word * 64 + __builtin_ctzll(bits), &mine_row, &mine_column);
+            if (mine_row < first_mine_row || mine_row >= end_mine_row) continue;
+
+            // Add one to all neighboring tiles.  The counts of mines are never looked at, so
+            // neighbours that are mines themselves don't need to be skipped.
+            for (int j = -1; j <= 1; j ++)
+            {
+                // Get the row of the neighboring tile
+                int row = mine_row + j;
+                if (row < first_row || row >= end_row) continue;
+
+                for (int k = -1; k <= 1; k ++)
+                {
+                    // Get the column of the neighboring tile (skipping the mine itself)
+                    int column = mine_column + k;
+                    if ((j == 0 && k == 0) || column < 0 || column >= width) continue;
+
+                    // Counts never go past 8, so adding to the tile's nibble can't carry into its neighbor
+                    size_t neighbor = tile_index(map, row, column);
+                    map->counts[neighbor >> 1] += 1 << ((neighbor & 1) * 4);
+                }
+            }
+        }
+    }
+}
+
+// Drop the tiles that have left the frontier from its list
+static void frontier_compact (Frontier * frontier)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < frontier->count; i ++)
+    {
+        size_t index = frontier->tiles[i];
+        if (test_bit(frontier->member, index)) frontier->tiles[kept ++] = index;
+        else clear_bit(frontier->listed, index);
+    }
+    frontier->count = kept;
+}
+
+static void frontier_add (Frontier * frontier, size_t index)
+{
+    if (test_bit(frontier->member, index)) return;
+    set_bit(frontier->member, index);
+    frontier->size ++;
+    if (test_bit(frontier->listed, index) || frontier->out_of_memory) return;
+
+    // When the list is full, drop the tiles that have left the frontier if they are at least
+    // half of it, otherwise double it, so the list is never more than twice the frontier
+    if (frontier->count == frontier->capacity)
+    {
+        if (frontier->capacity > 0 && frontier->capacity >= 2 * frontier->size)
+            frontier_compact(frontier);
+        else
+        {
+            size_t capacity = frontier->capacity > 0 ? frontier->capacity * 2 : 64;
+            size_t * bigger = realloc(frontier->tiles, sizeof(size_t) * capacity);
+            if (bigger == NULL)
+            {
+                frontier->out_of_memory = 1; // frontier_tiles makes the list again from member
+                return;
+            }
+            frontier->tiles = bigger;
+            frontier->capacity = capacity;
+        }
+    }
+    frontier->tiles[frontier->count ++] = index;
+    set_bit(frontier->listed, index);
+}
+
+static void frontier_remove (Frontier * frontier, size_t index)
+{
+    if (!test_bit(frontier->member, index)) return;
+    clear_bit(frontier->member, index);
+    frontier->size --;
+}
+
+// The bits of a word of a plane that are tiles on the map (not past its edge)
+static uint64_t word_tiles (const Board * map, size_t word)
+{
+    if (map->layout == LAYOUT_TILED)
+    {
+        // A block is 8 rows of 8 bits, cut short at the bottom and right edges
+        int row, column;
+        tile_position(map, word * 64, &row, &column);
+        int rows = map->height - row < 8 ? map->height - row : 8;
+        int columns = map->width - column < 8 ? map->width - column : 8;
+        uint64_t line = ((uint64_t)1 << columns) - 1;
+        return line * 0x0101010101010101ULL >> (8 * (8 - rows));
+    }
+    size_t tiles = (size_t)map->width * map->height;
+    return (word + 1) * 64 <= tiles ? ~(uint64_t)0 : ((uint64_t)1 << (tiles % 64)) - 1;
+}
+
+// Three bits of a plane from index on (as bits 0-2)
+static inline unsigned three_tiles (const uint64_t * plane, size_t index, size_t words)
+{
+    unsigned shift = index & 63;
+    uint64_t bits = plane[index >> 6] >> shift;
+    if (shift > 61 && (index >> 6) + 1 < words) bits |= plane[(index >> 6) + 1] << (64 - shift);
+    return bits & 7;
+}
+
+// Put the hidden, unmarked neighbours of an open tile on the frontier
+static void frontier_open (Board * map, int row, int column)
+{
+    Frontier * frontier = map->frontier;
+    if (map->layout == LAYOUT_ROWS)
+    {
+        // A row of the 3x3 block is three bits in a row, so look at them all at once instead
+        // of testing each neighbour on its own
+        size_t words = map_words(map);
+        int first = column > 0 ? column - 1 : column;
+        int last = column + 1 < map->width ? column + 1 : column;
+        unsigned on_map = (1u << (last - first + 1)) - 1;
+        for (int neighbor_row = row - 1; neighbor_row <= row + 1; neighbor_row ++)
+        {
+            if (neighbor_row < 0 || neighbor_row >= map->height) continue;
+            size_t start = tile_index(map, neighbor_row, first);
+            unsigned taken = three_tiles(map->revealed, start, words) | three_tiles(map->flags, start, words) |
+                             three_tiles(frontier->member, start, words);
+            for (unsigned joining = ~taken & on_map; joining != 0; joining &= joining - 1)
+                frontier_add(frontier, start + __builtin_ctz(joining));
+        }
+        return;
+    }
+
+    for (int i = -1; i <= 1; i ++)
+    {
+        for (int j = -1; j <= 1; j ++)
+        {
+            int neighbor_row = row + i;
+            int neighbor_column = column + j;
+            if (neighbor_row < 0 || neighbor_row >= map->height || neighbor_column < 0 || neighbor_column >= map->width) continue;
+            size_t index = tile_index(map, neighbor_row, neighbor_column);
+            if (!test_bit(map->revealed, index) && !test_bit(map->flags, index)) frontier_add(frontier, index);
+        }
+    }
+}
+
+// Whether a tile has an open neighbour that isn't a mine
+static int next_to_open (const Board * map, int row, int column)
+{
+    if (map->layout == LAYOUT_ROWS)
+    {
+        // Three bits at a time, like frontier_open
+        size_t words = map_words(map);
+        int first = column > 0 ? column - 1 : column;
+        int last = column + 1 < map->width ? column + 1 : column;
+        unsigned on_map = (1u << (last - first + 1)) - 1;
+        for (int neighbor_row = row - 1; neighbor_row <= row + 1; neighbor_row ++)
+        {
+            if (neighbor_row < 0 || neighbor_row >= map->height) continue;
+            size_t start = tile_index(map, neighbor_row, first);
+            if (three_tiles(map->revealed, start, words) & ~three_tiles(map->mines, start, words) & on_map) return 1;
+        }
+        return 0;
+    }
+
+    for (int i = -1; i <= 1; i ++)
+    {
+        for (int j = -1; j <= 1; j ++)
+        {
+            int neighbor_row = row + i;
+            int neighbor_column = column + j;
+            if (neighbor_row < 0 || neighbor_row >= map->height || neighbor_column < 0 || neighbor_column >= map->width) continue;
+            size_t index = tile_index(map, neighbor_row, neighbor_column);
+            if (test_bit(map->revealed, index) && !test_bit(map->mines, index)) return 1;
+        }
+    }
+    return 0;
+}
+
+int frontier_track (Board * map)
+{
+    if (map->frontier != NULL) return 0;
+    size_t words = map_words(map);
+    Frontier * frontier = calloc(1, sizeof(Frontier));
+    if (frontier == NULL) return -1;
+    frontier->member = calloc(words * 2, sizeof(uint64_t));
+    if (frontier->member == NULL)
+    {
+        free(frontier);
+        return -1;
+    }
+    frontier->listed = frontier->member + words;
+    map->frontier = frontier;
+
+    // From here on the counts are kept as tiles are opened and marked
+    for (size_t word = 0; word < words; word ++)
+    {
+        frontier->hidden += __builtin_popcountll(~(map->revealed[word] | map->flags[word]) & word_tiles(map, word));
+        frontier->marked += __builtin_popcountll(map->flags[word] & ~map->revealed[word]);
+    }
+
+    // Every open tile that isn't a mine puts its hidden neighbours on the frontier
+    for (size_t word = 0; word < words; word ++)
+    {
+        for (uint64_t bits = map->revealed[word] & ~map->mines[word]; bits != 0; bits &= bits - 1)
+        {
+            int row, column;
+            tile_position(map, word * 64 + __builtin_ctzll(bits), &row, &column);
+            if (row >= map->height || column >= map->width) continue; // past the edge (see reveal_map)
+            frontier_open(map, row, column);
+        }
+    }
+    if (frontier->out_of_memory)
+    {
+        frontier_untrack(map);
+        return -1;
+    }
+    return 0;
+}
+
+void frontier_untrack (Board * map)
+{
+    if (map->frontier == NULL) return;
+    free(map->frontier->member);
+    free(map->frontier->tiles);
+    free(map->frontier);
+    map->frontier = NULL;
+}
+
+int frontier_tiles (const Board * map, const size_t ** tiles, size_t * count)
+{
+    Frontier * frontier = map->frontier;
+    if (frontier->out_of_memory)
+    {
+        // The list couldn't grow at some point, so make it again from the member plane
+        size_t words = map_words(map);
+        size_t capacity = frontier->size > 64 ? frontier->size : 64;
+        size_t * bigger = realloc(frontier->tiles, sizeof(size_t) * capacity);
+        if (bigger == NULL) return -1;
+        frontier->tiles = bigger;
+        frontier->capacity = capacity;
+        frontier->count = 0;
+        for (size_t word = 0; word < words; word ++)
+        {
+            frontier->listed[word] = frontier->member[word];
+            for (uint64_t bits = frontier->member[word]; bits != 0; bits &= bits - 1)
+                frontier->tiles[frontier->count ++] = word * 64 + __builtin_ctzll(bits);
+        }
+        frontier->out_of_memory = 0;
+    }
+    else if (frontier->count > frontier->size)
+        frontier_compact(frontier);
+
+    *tiles = frontier->tiles;
+    *count = frontier->count;
+    return 0;
+}
+
+void count_hidden (const Board * map, long long * hidden, long long * marked)
+{
+    if (map->frontier != NULL)
+    {
+        *hidden = map->frontier->hidden;
+        *marked = map->frontier->marked;
+        return;
+    }
+    size_t words = map_words(map);
+    *hidden = *marked = 0;
+    for (size_t word = 0; word < words; word ++)
+    {
+        *hidden += __builtin_popcountll(~(map->revealed[word] | map->flags[word]) & word_tiles(map, word));
+        *marked += __builtin_popcountll(map->flags[word] & ~map->revealed[word]);
+    }
+}
+
+// Flip a single hidden tile and add one to the score
+// Returns 1 if the tile has no surrounding mines (so its neighbours have to be flipped too)
+static int flip_tile (Board * map, int row, int column, size_t index, long long * score, MsChanges * changes, MsHistory * history)
+{
+    // Increment the score
+    *score = *score + 1;
+    if (changes != NULL) add_change(changes, index);
+    if (history != NULL) history_add(history, index, test_bit(map->flags, index) ? HISTORY_OPENED_MARKED : HISTORY_OPENED);
+
+    // Open the tile and remove its mark if it had one
+    if (map->frontier != NULL)
+    {
+        if (test_bit(map->flags, index)) map->frontier->marked --;
+        else map->frontier->hidden --;
+    }
+    set_bit(map->revealed, index);
+    clear_bit(map->flags, index);
+
+    // The neighbours of a tile with no surrounding mines are about to be flipped too, so only
+    // a number's neighbours join the frontier
+    int zero = tile_count(map, index) == 0;
+    if (map->frontier != NULL)
+    {
+        frontier_remove(map->frontier, index);
+        if (!zero) frontier_open(map, row, column);
+    }
+    return zero;
+}
+
+int reveal_tile (int column, int row, long long * score, Board * map)
+{
+    return open_tiles(column, row, score, map, NULL, NULL);
+}
+
+int reveal_tile_changes (int column, int row, long long * score, Board * map, MsChanges * changes)
+{
+    return open_tiles(column, row, score, map, changes, NULL);
+}
+
+// reveal_tile, adding every tile it opens to changes and the move being recorded in history (if
+// they aren't NULL)
+static int open_tiles (int column, int row, long long * score, Board * map, MsChanges * changes, MsHistory * history)
+{
+    int width = map->width;
+    int height = map->height;
+
+    // Check if the tile is out of range
+    if (column < 0 || column >= width || row < 0 || row >= height) return 0;
+
+    // If it's a mine, let the caller decide what happens
+    size_t index = tile_index(map, row, column);
+    if (test_bit(map->mines, index)) return 1;
+
+    // If the tile has already been flipped, do nothing
+    if (test_bit(map->revealed, index)) return 0;
+
+    // Flip it, and if it has no surrounding mines flip its neighbours using a queue of zero
+    // tiles instead of recursion.  A tile is flipped at the moment it is queued, so each tile
+    // is queued at most once and already open neighbours are skipped.  The queue is first in,
+    // first out so it only ever holds the edge of the opening, not the whole opening.
+    // Small openings fit in local_queue; bigger ones move the queue to the heap.
+    int local_queue[256][2];
+    int (*queue)[2] = local_queue;
+    size_t capacity = sizeof(local_queue) / sizeof(local_queue[0]);
+    size_t head = 0; // next tile to take off the queue
+    size_t count = 0; // number of tiles in the queue
+    int result = 0;
+
+    if (flip_tile(map, row, column, index, score, changes, history))
+    {
+        queue[0][0] = row;
+        queue[0][1] = column;
+        count = 1;
+    }
+
+    while (count > 0)
+    {
+        int zero_row = queue[head][0];
+        int zero_column = queue[head][1];
+        head = (head + 1) & (capacity - 1); // capacity is always a power of two
+        count--;
+
+        // Loop through neighbors (a tile with no surrounding mines never has a mine next to it)
+        for (int i = -1; i <= 1 && result == 0; i ++)
+        {
+            int neighbor_row = zero_row + i;
+            if (neighbor_row < 0 || neighbor_row >= height) continue;
+
+            for (int j = -1; j <= 1; j ++)
+            {
+                int neighbor_column = zero_column + j;
+                if (neighbor_column < 0 || neighbor_column >= width) continue;
+
+                index = tile_index(map, neighbor_row, neighbor_column);
+                if (test_bit(map->revealed, index) || !flip_tile(map, neighbor_row, neighbor_column, index, score, changes, history)) continue;
+
+                // Queue the new zero tile, doubling the queue if it's full
+                if (count == capacity)
+                {
+                    int (*bigger)[2] = malloc(sizeof(int[2]) * capacity * 2);
+                    if (bigger == NULL)
+                    {
+                        // Out of memory: leave the rest of the opening closed.  Its edge is the
+                        // hidden neighbours of the zero tiles that haven't been looked at.
+                        if (map->frontier != NULL)
+                        {
+                            frontier_open(map, zero_row, zero_column);
+                            frontier_open(map, neighbor_row, neighbor_column);
+                            for (size_t k = 0; k < count; k ++)
+                                frontier_open(map, queue[(head + k) & (capacity - 1)][0], queue[(head + k) & (capacity - 1)][1]);
+                        }
+                        result = -1;
+                        count = 0;
+                        break;
+                    }
+                    // Unwrap the ring so the tiles start at index 0 again
+                    memcpy(bigger, queue + head, sizeof(int[2]) * (capacity - head));
+                    memcpy(bigger + (capacity - head), queue, sizeof(int[2]) * head);
+                    if (queue != local_queue) free(queue);
+                    queue = bigger;
+                    head = 0;
+                    capacity *= 2;
+                }
+                size_t tail = (head + count) & (capacity - 1);
+                queue[tail][0] = neighbor_row;
+                queue[tail][1] = neighbor_column;
+                count++;
+            }
+        }
+    }
+
+    if (queue != local_queue) free(queue);
+    return result;
+}
+
+// Reveals the entire map for end game
+void reveal_map (Board * map)
+{
+    size_t words = map_words(map);
+
+    // Every tile is open and nothing is marked anymore (bits past the last tile are never looked at)
+    memset(map->revealed, 0xFF, words * sizeof(uint64_t));
+    memset(map->flags, 0, words * sizeof(uint64_t));
+
+    // So nothing is left on the frontier
+    if (map->frontier != NULL)
+    {
+        memset(map->frontier->member, 0, words * 2 * sizeof(uint64_t));
+        map->frontier->count = map->frontier->size = 0;
+        map->frontier->hidden = map->frontier->marked = 0;
+        map->frontier->out_of_memory = 0;
+    }
+}
+
+// Mark a tile as a potential mine
+int mark_tile (int row, int column, Board * map)
+{
+    // If (row, column) is out of range, return -100
+    if (row >= map->height || column >= map->width || row < 0 || column < 0) return -100;
+
+    // Revealed tiles can't be marked
+    size_t index = tile_index(map, row, column);
+    if (test_bit(map->revealed, index)) return 1;
+
+    // Mark the tile if it's unmarked, or unmark it if it's already marked
+    map->flags[index >> 6] ^= (uint64_t)1 << (index & 63);
+    if (map->frontier != NULL)
+    {
+        int marked = test_bit(map->flags, index);
+        map->frontier->marked += marked ? 1 : -1;
+        map->frontier->hidden += marked ? -1 : 1;
+        if (marked) frontier_remove(map->frontier, index);
+        else if (next_to_open(map, row, column)) frontier_add(map->frontier, index);
+    }
+    return 0;
+}
+
+
+/* Undo History */
+
+// Read the next tile of a move in the history, adding the difference to *index
+// Returns the kind of tile (see MsHistory)
+static int next_history_tile (MsHistory * history, size_t * offset, size_t * index)
+{
+    uint64_t value = ring_varint(history, offset, 0);
+    uint64_t zigzag = value >> 2;
+    *index += (size_t)(zigzag >> 1 ^ -(zigzag & 1));
+    return value & 3;
+}
+
+// Undo (redo = 0) or play again (redo = 1) the move whose tiles are at offset in the history
+static void replay_move (Game * game, size_t offset, size_t length, int redo)
+{
+    MsHistory * history = game->history;
+    Board * map = &game->map;
+    long long opened = 0;
+    int mine = 0;
+    size_t index = 0;
+    for (size_t at = offset; at < offset + length; )
+    {
+        int kind = next_history_tile(history, &at, &index);
+        if (kind == HISTORY_MINE)
+            mine = 1;
+        else if (kind == HISTORY_MARKED)
+        {
+            // Marking and unmarking are the same toggle (and mark_tile keeps the frontier)
+            int row, column;
+            tile_position(map, index, &row, &column);
+            mark_tile(row, column, map);
+        }
+        else
+        {
+            if (redo)
+            {
+                if (map->frontier != NULL && test_bit(map->flags, index)) map->frontier->marked --;
+                else if (map->frontier != NULL) map->frontier->hidden --;
+                set_bit(map->revealed, index);
+                clear_bit(map->flags, index);
+            }
+            else
+            {
+                clear_bit(map->revealed, index);
+                if (kind == HISTORY_OPENED_MARKED) set_bit(map->flags, index);
+                if (map->frontier != NULL && kind == HISTORY_OPENED_MARKED) map->frontier->marked ++;
+                else if (map->frontier != NULL) map->frontier->hidden ++;
+            }
+            opened ++;
+        }
+    }
+
+    // Only once every tile is back can the frontier be worked out.  Opening tiles only takes
+    // them off the frontier and puts their hidden neighbours on it; closing them only puts them
+    // back on and takes off the neighbours that have no open tile next to them anymore.
+    if (map->frontier != NULL && opened > 0)
+    {
+        index = 0;
+        for (size_t at = offset; at < offset + length; )
+        {
+            int kind = next_history_tile(history, &at, &index);
+            if (kind != HISTORY_OPENED && kind != HISTORY_OPENED_MARKED) continue;
+            int row, column;
+            tile_position(map, index, &row, &column);
+            if (redo)
+            {
+                frontier_remove(map->frontier, index);
+                frontier_open(map, row, column);
+                continue;
+            }
+
+            if (!test_bit(map->flags, index) && next_to_open(map, row, column)) frontier_add(map->frontier, index);
+            for (int i = -1; i <= 1; i ++)
+            {
+                for (int j = -1; j <= 1; j ++)
+                {
+                    int neighbor_row = row + i;
+                    int neighbor_column = column + j;
+                    if (neighbor_row < 0 || neighbor_row >= map->height || neighbor_column < 0 || neighbor_column >= map->width) continue;
+                    size_t neighbor = tile_index(map, neighbor_row, neighbor_column);
+                    if (on_frontier(map, neighbor) && !next_to_open(map, neighbor_row, neighbor_column))
+                        frontier_remove(map->frontier, neighbor);
+                }
+            }
+        }
+    }
+
+    // Each overturned tile adds one to the score
+    game->score += redo ? opened : -opened;
+    game->free_positions += redo ? -opened : opened;
+    game->status = !redo ? MS_PLAYING : mine ? MS_LOST : game->free_positions <= 0 ? MS_WON : MS_PLAYING;
+}
+
+MsResult ms_undo (Game * game)
+{
+    MsHistory * history = game->history;
+    if (history == NULL || history->undos == 0) return MS_NO_CHANGE;
+
+    // The length at the end of the record says where its tiles start
+    size_t end = history->done;
+    size_t length = ring_varint(history, &end, 1);
+    size_t start = end - length;
+    replay_move(game, start, length, 0);
+    history->done = start - (history->done - end);
+    history->undos --;
+    history->redos ++;
+    return MS_OK;
+}
+
+MsResult ms_redo (Game * game)
+{
+    MsHistory * history = game->history;
+    if (history == NULL || history->redos == 0) return MS_NO_CHANGE;
+
+    size_t start = history->done;
+    size_t length = ring_varint(history, &start, 0);
+    replay_move(game, start, length, 1);
+    history->done = start + length + (start - history->done);
+    history->undos ++;
+    history->redos --;
+    return MS_OK;
+}
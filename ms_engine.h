@@ -0,0 +1,521 @@
+// Headless Minesweeper engine
+// Everything in here works on plain memory: nothing prints, reads stdin or exits, so
+// bots and simulators can drive as many games as they like from a single process.
+// The terminal screens in Minesweeper.c are built on top of these calls.
+#ifndef MS_ENGINE_H
+#define MS_ENGINE_H
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "rng.h"
+
+// Result of a single move
+typedef enum
+{
+    MS_OK = 0,          // the move changed the board
+    MS_NO_CHANGE,       // the move was valid but did nothing (e.g. the tile was already open)
+    MS_MINE,            // the revealed tile was a mine, the game is now lost
+    MS_OUT_OF_RANGE,    // row or column is outside of the map
+    MS_GAME_OVER,       // the game has already been won or lost
+    MS_NO_MEMORY        // ran out of memory part way through the move
+} MsResult;
+
+// State of a game
+typedef enum
+{
+    MS_PLAYING = 0,
+    MS_WON,
+    MS_LOST
+} MsStatus;
+
+// Order of the tiles in the planes of a map (see tile_index)
+typedef enum
+{
+    LAYOUT_ROWS = 0,        // row by row, left to right
+    LAYOUT_TILED            // 8x8 blocks of tiles, row by row, and the blocks row by row.  A block
+                            //   is one word of a bit plane (and 32 bytes of counts), so a tile and
+                            //   its neighbours are in one or a few words however wide the map is
+} BoardLayout;
+
+// The frontier of a map: its hidden, unmarked tiles next to an open tile (see frontier_track).
+// These are the only tiles the open numbers say anything about.
+//   member: one bit per tile, set for the tiles on the frontier
+//   tiles: list of the tiles on the frontier, in no particular order.  A tile that leaves the
+//          frontier only has its member bit cleared, and is dropped from the list the next
+//          time the list is read or has to grow, so adding and removing a tile are O(1).
+typedef struct
+{
+    uint64_t * member;
+    uint64_t * listed;      // one bit per tile, set for the tiles in the list
+    size_t * tiles;
+    size_t count;           // tiles in the list (some of them may have left the frontier)
+    size_t capacity;        // room in the list
+    size_t size;            // tiles on the frontier
+    long long hidden;       // hidden, unmarked tiles on the whole map
+    long long marked;       // marked tiles on the whole map
+    int out_of_memory;      // set when the list couldn't grow (it's rebuilt from member when read)
+} Frontier;
+
+// The map, stored as separate planes instead of one int per tile
+//   mines, revealed, flags: one bit per tile, 64 tiles per word
+//   counts: number of surrounding mines, 4 bits per tile (two tiles per byte)
+// A tile is 7 bits instead of 32, and every question about a tile is a single bit test.
+// Only the map functions (and the tile functions) know about LAYOUT_TILED, for ms_bench to
+// compare the layouts; games always use LAYOUT_ROWS, since the solver, the probabilities, the
+// renderer, save files and the rest walk the planes a row at a time.  solve_map,
+// mine_probabilities, render_frame and render_map refuse any other layout (they return -1).
+typedef struct
+{
+    int width;              // number of columns
+    int height;             // number of rows
+    BoardLayout layout;
+    uint64_t * mines;
+    uint64_t * revealed;
+    uint64_t * flags;
+    uint8_t * counts;
+    Frontier * frontier;    // kept up to date by reveal_tile, mark_tile, reveal_map, ms_undo and
+                            //   ms_redo, or NULL
+} Board;
+
+// Kind of move in a batch (see ms_apply)
+typedef enum
+{
+    MS_MOVE_REVEAL = 0,     // ms_reveal
+    MS_MOVE_MARK,           // ms_mark
+    MS_MOVE_CHORD           // ms_chord
+} MsMoveType;
+
+// One move of a batch
+typedef struct
+{
+    MsMoveType type;
+    int row;                // tile (both start at 0)
+    int column;
+} MsMove;
+
+// What a batch of moves did (see ms_apply)
+// Start with every field 0 and keep passing the same one to ms_apply, so the list is only
+// allocated again when a batch changes more tiles than any before it.
+typedef struct
+{
+    size_t * tiles;         // every tile that changed (see tile_index), once each, in map order
+    size_t count;           // number of tiles in the list
+    size_t capacity;        // room in the list
+    size_t moves;           // how many moves of the batch were played
+    int out_of_memory;      // set while the list can't grow (ms_apply then returns MS_NO_MEMORY)
+} MsChanges;
+
+// The moves of a game that can be undone and redone (see ms_history_start)
+// Each move is kept as the tiles it changed, not as a copy of the map, in a ring of bytes that
+// never grows past the cap: when a new move doesn't fit, the oldest moves are forgotten.  A move
+// is one record:
+//
+//      length      varint, number of bytes in the tiles
+//      tiles       one varint per tile: (zigzag(tile_index - the previous tile's) << 2) | kind,
+//                  where kind is 0 = opened, 1 = opened and was marked, 2 = marked or unmarked,
+//                  3 = the mine that lost the game (the first tile is compared with 0)
+//      length      the same varint with its bytes in reverse, so the ring can be read backwards
+//
+// Varints are 7 bits per byte, low bits first, top bit set on all but the last byte (like a
+// journal).  The tiles of an opening are next to each other, so most of them take one byte.
+typedef struct
+{
+    uint8_t * bytes;        // the ring of records
+    size_t capacity;        // size of the ring (the cap)
+    size_t first;           // where in the ring the oldest record starts
+    size_t length;          // bytes of records from first on
+    size_t done;            // how many of them are moves that can be undone (the rest can be redone)
+    long long undos;        // number of moves that can be undone
+    long long redos;        // number of moves that can be redone
+    uint8_t * move;         // tiles of the move being played
+    size_t move_length;
+    size_t move_capacity;
+    size_t previous;        // last tile added to the move
+    int broken;             // set when the move being played can't be kept (too big or out of memory)
+} MsHistory;
+
+// Function told about every move a game is given (see Game)
+//   void * data: the game's on_move_data
+//   int mark: 1 for ms_mark, 0 for ms_reveal
+//   int row, int column: the tile (inside the map)
+typedef void (* MsMoveHook) (void * data, int mark, int row, int column);
+
+// A single game of Minesweeper
+typedef struct
+{
+    int width;              // number of columns
+    int height;             // number of rows
+    long long num_mines;    // number of mines on the map
+    Board map;              // the tiles (see Board)
+    long long score;        // number of tiles overturned
+    long long free_positions; // number of tiles left to overturn before the game is won
+    time_t start_time;      // time the game was created
+    MsStatus status;
+    uint64_t seed;          // seed the map was generated from
+    Rng rng;                // the game's own random numbers
+    void * mapping;         // saved game the map's planes are mapped from (see ms_load), or NULL
+    size_t mapping_size;
+    MsMoveHook on_move;     // called by ms_reveal and ms_mark before every move on the map while
+    void * on_move_data;    //   the game is being played (e.g. to record it), or NULL
+    MsHistory * history;    // moves that can be undone (see ms_history_start), or NULL
+} Game;
+
+
+/* Game Functions */
+// ms_new -> Game *
+//   int width: width of map
+//   int height: height of map
+//   long long num_mines: number of mines to plant
+//   uint64_t seed: seed for the game's random numbers (e.g. rng_time_seed())
+// Allocates a new game and generates a random map for it.
+// The same seed, width, height and number of mines always give the same map.
+// Returns NULL if the dimensions are invalid or if it runs out of memory.
+Game * ms_new (int width, int height, long long num_mines, uint64_t seed);
+
+// ms_new_at -> Game *
+//   int width, int height, long long num_mines, uint64_t seed: see ms_new
+//   int row, int column: the first move (both start at 0)
+// Like ms_new, but keeps the first tile and its neighbours free of mines (as long as there
+// is room for the mines elsewhere) and then reveals it, so the game starts with an opening.
+// Returns NULL if the dimensions or the first move are invalid or if it runs out of memory.
+Game * ms_new_at (int width, int height, long long num_mines, uint64_t seed, int row, int column);
+
+// ms_free
+//   Game * game: game returned by ms_new (may be NULL)
+// Frees the game and its map
+void ms_free (Game * game);
+
+// ms_reveal -> MsResult
+//   Game * game
+//   int row: row of the tile (starts at 0)
+//   int column: column of the tile (starts at 0)
+// Overturns a tile (and its neighbours if it has no surrounding mines) and updates the
+// score, the number of free positions and the status of the game.
+// Returns MS_MINE if the tile was a mine, MS_NO_CHANGE if it was already open.
+MsResult ms_reveal (Game * game, int row, int column);
+
+// ms_mark -> MsResult
+//   Game * game
+//   int row: row of the tile (starts at 0)
+//   int column: column of the tile (starts at 0)
+// Marks a hidden tile as a potential mine, or unmarks it if it was already marked.
+// Returns MS_NO_CHANGE if the tile has already been revealed.
+MsResult ms_mark (Game * game, int row, int column);
+
+// ms_chord -> MsResult
+//   Game * game
+//   int row: row of an open number (starts at 0)
+//   int column: column of an open number (starts at 0)
+// If as many of the number's neighbours are marked as it has surrounding mines, reveals all of
+// its other hidden neighbours at once (like ms_reveal on each of them, so a wrong mark loses
+// the game).
+// Returns MS_NO_CHANGE if the tile isn't an open number with exactly that many marks around it.
+MsResult ms_chord (Game * game, int row, int column);
+
+// ms_apply -> MsResult
+//   Game * game
+//   const MsMove * moves: reveals, marks and chords to play in order
+//   size_t count: number of moves
+//   MsChanges * changes: output, the tiles the moves changed (may be NULL)
+// Plays a batch of moves in one call, so a bot or a client of the server makes one call and
+// draws one frame for the whole batch.  Stops early at a move that is out of range or that ends
+// the game; changes->moves says how many were played.
+// Returns MS_MINE if a move stepped on a mine, MS_OUT_OF_RANGE or MS_NO_MEMORY if it stopped
+// because of a move, MS_GAME_OVER if the game was already over, MS_OK if any move changed the
+// board, or MS_NO_CHANGE.
+MsResult ms_apply (Game * game, const MsMove * moves, size_t count, MsChanges * changes);
+
+// ms_changes_free
+//   MsChanges * changes
+// Frees the list of tiles (the MsChanges can be used again afterwards)
+void ms_changes_free (MsChanges * changes);
+
+// ms_status -> MsStatus
+//   const Game * game
+// Returns whether the game is still being played, won or lost
+MsStatus ms_status (const Game * game);
+
+// ms_history_start -> int
+//   Game * game
+//   size_t max_bytes: most bytes the recorded moves may take (a move is only kept if it fits;
+//                     while it is being played it takes up to as much again)
+// Starts keeping the moves ms_reveal, ms_mark, ms_chord and ms_apply play from now on, so they
+// can be taken back with ms_undo (see MsHistory).  Each move costs a few bytes a tile it
+// changed, and once the cap is reached the oldest moves are forgotten.  The map's planes mustn't
+// be changed any other way while the history is kept (ms_solve forgets it).  Undoing a move isn't
+// passed to on_move, so a game being recorded in a journal shouldn't keep a history.
+// Starting it again does nothing.
+// Returns 0, or -1 if max_bytes is 0 or it runs out of memory
+int ms_history_start (Game * game, size_t max_bytes);
+
+// ms_history_clear
+//   Game * game
+// Forgets every move that could be undone or redone (the history is still kept from now on)
+void ms_history_clear (Game * game);
+
+// ms_history_stop
+//   Game * game
+// Stops keeping the history and frees it (ms_free does this too)
+void ms_history_stop (Game * game);
+
+// ms_undo -> MsResult
+//   Game * game
+// Takes back the last move still in the history (even one that won or lost the game), putting
+// back the tiles, score, free positions and status from before it.  Takes time in proportion
+// to the number of tiles the move changed, not to the map.
+// Returns MS_OK, or MS_NO_CHANGE if there's no move to undo
+MsResult ms_undo (Game * game);
+
+// ms_redo -> MsResult
+//   Game * game
+// Plays the last move that was undone again (until a new move is played, which forgets the moves
+// that were undone)
+// Returns MS_OK, or MS_NO_CHANGE if there's no move to redo
+MsResult ms_redo (Game * game);
+
+
+/* Tile Functions */
+// tile_index -> size_t
+//   const Board * map
+//   int row, int column: position of the tile (both start at 0)
+// Returns the position of the tile in each of the map's planes
+static inline size_t tile_index (const Board * map, int row, int column)
+{
+    if (map->layout == LAYOUT_TILED)
+    {
+        size_t block = (size_t)(row >> 3) * ((map->width + 7) >> 3) + (column >> 3);
+        return block << 6 | (row & 7) << 3 | (column & 7);
+    }
+    return (size_t)row * map->width + column;
+}
+
+// tile_position
+//   const Board * map
+//   size_t index: tile_index of a tile
+//   int * row, int * column: output, position of the tile
+static inline void tile_position (const Board * map, size_t index, int * row, int * column)
+{
+    if (map->layout == LAYOUT_TILED)
+    {
+        size_t block = index >> 6;
+        size_t blocks_across = (map->width + 7) >> 3;
+        *row = (int)(block / blocks_across) << 3 | (int)(index >> 3 & 7);
+        *column = (int)(block % blocks_across) << 3 | (int)(index & 7);
+        return;
+    }
+    *row = index / map->width;
+    *column = index % map->width;
+}
+
+// test_bit -> int
+//   const uint64_t * plane: mines, revealed or flags
+//   size_t index: tile_index of the tile
+// Returns 1 if the tile's bit is set, otherwise 0
+static inline int test_bit (const uint64_t * plane, size_t index)
+{
+    return (plane[index >> 6] >> (index & 63)) & 1;
+}
+
+// set_bit / clear_bit
+//   uint64_t * plane: mines, revealed or flags
+//   size_t index: tile_index of the tile
+static inline void set_bit (uint64_t * plane, size_t index)
+{
+    plane[index >> 6] |= (uint64_t)1 << (index & 63);
+}
+static inline void clear_bit (uint64_t * plane, size_t index)
+{
+    plane[index >> 6] &= ~((uint64_t)1 << (index & 63));
+}
+
+// on_frontier -> int
+//   const Board * map: map whose frontier is tracked (see frontier_track)
+//   size_t index: tile_index of the tile
+// Returns 1 if the tile is hidden, unmarked and next to an open tile, otherwise 0
+static inline int on_frontier (const Board * map, size_t index)
+{
+    return test_bit(map->frontier->member, index);
+}
+
+// tile_count -> int
+//   const Board * map
+//   size_t index: tile_index of the tile
+// Returns the number of mines surrounding the tile (0-8)
+static inline int tile_count (const Board * map, size_t index)
+{
+    return (map->counts[index >> 1] >> ((index & 1) * 4)) & 0xF;
+}
+
+
+/* Map Functions */
+// initialize_map -> int
+//   int width: width of map
+//   int height: height of map
+//   Board * map: pointer to output map
+// Allocates the map's planes and initializes each tile to hidden, unmarked and with no mines.
+// Returns 0, or -1 if it runs out of memory (the map is then left empty).
+int initialize_map (int width, int height, Board * map);
+
+// initialize_map_layout -> int
+//   int width, int height, Board * map: see initialize_map
+//   BoardLayout layout: order of the tiles in the planes
+// initialize_map with a choice of layout.  A tiled map's planes are rounded up to whole 8x8
+// blocks, and the tiles past the edges are never mines.
+int initialize_map_layout (int width, int height, BoardLayout layout, Board * map);
+
+// map_words -> size_t
+//   const Board * map
+// Returns the number of words in each of the map's bit planes
+size_t map_words (const Board * map);
+
+// map_count_bytes -> size_t
+//   const Board * map
+// Returns the size of the map's counts plane in bytes
+size_t map_count_bytes (const Board * map);
+
+// free_map
+//   Board * map: map set up by initialize_map
+// Frees the map's planes
+void free_map (Board * map);
+
+// plant_mines
+//   long long num: number of mines (at most width * height)
+//   Board * map: map from initialize_map
+//   Rng * rng: random numbers to plant the mines with
+// Sets the bits of exactly num distinct, uniformly random tiles in the mines plane.
+// Uses Floyd's sampling algorithm, so it takes num random draws no matter how many tiles are
+// already mines.  If more than half of the map is mines, it fills the map and picks the free
+// tiles instead.
+void plant_mines (long long num, Board * map, Rng * rng);
+
+// clear_around
+//   Board * map: map with its mines planted
+//   int row, int column: the tile to clear
+//   Rng * rng: random numbers to move the mines with
+// Moves any mines on the tile and its neighbours to random free tiles outside of them (as many
+// as there is room for).  A uniformly random map stays uniformly random among the maps that
+// have no mines there.
+void clear_around (Board * map, int row, int column, Rng * rng);
+
+// generate_map
+//   Board * map: map with its mines planted and all counts 0
+// Loops through each mine and adds 1 to the count of each surrounding tile.
+void generate_map (Board * map);
+
+// generate_rows
+//   Board * map: map with its mines planted and the counts of the rows 0
+//   int first_row, int end_row: rows to count, from first_row up to (not including) end_row
+// generate_map for just those rows.  It reads the mines of the rows around them too, but only
+// ever writes their counts.
+void generate_rows (Board * map, int first_row, int end_row);
+
+// Ways of computing the counts plane (see count_mines)
+typedef enum
+{
+    COUNT_AUTO = 0,     // fastest one the CPU supports
+    COUNT_SCALAR,       // plain C, one tile at a time
+    COUNT_SSE2,         // 16 tiles at a time (any x86-64 CPU)
+    COUNT_AVX2          // 32 tiles at a time
+} CountKernel;
+
+// count_mines -> CountKernel
+//   Board * map: map with its mines plane filled in
+//   CountKernel kernel: which implementation to use
+// Fills in the counts plane as a 3x3 box-sum over the mines plane, a whole row at a time.
+// Gives exactly the same counts as generate_map's per-mine loop, but only ever reads
+// the mines plane in order, so it doesn't slow down on big or dense maps.
+// Returns the kernel that was used (falls back if the CPU can't run the one asked for),
+// or COUNT_AUTO if it ran out of memory.
+CountKernel count_mines (Board * map, CountKernel kernel);
+
+// Maps with at least this many tiles are counted on every core (see count_striped)
+#define STRIPED_TILES (1 << 22)
+
+// count_striped -> int
+//   Board * map: map with its mines planted and all counts 0
+//   int box_sum: 1 to count with count_mines (COUNT_AUTO), 0 with generate_map's per-mine loop
+//   int threads: number of threads (0 = one per core)
+// Splits the map into horizontal stripes of rows, one per thread, and counts each stripe on its
+// own thread.  A thread reads the mine rows just above and below its stripe (its halo) but only
+// writes the counts of its own rows, and stripes never start half way through a byte of the
+// counts plane, so no two threads ever write the same byte.  The counts come out exactly the same
+// as generate_map's, whatever the number of threads.  The mines are still planted by one thread
+// (plant_mines draws them in order from one Rng, which is what makes a seed give the same map).
+// Returns the number of threads that counted
+int count_striped (Board * map, int box_sum, int threads);
+
+// frontier_track -> int
+//   Board * map
+// Starts keeping track of the map's frontier: the hidden, unmarked tiles next to an open tile
+// that isn't a mine (see Frontier), along with the number of hidden and marked tiles (see
+// count_hidden).  Finding them takes one pass over the planes; after that reveal_tile,
+// mark_tile and reveal_map keep them up to date as they go, at O(1) a tile, so solve_map,
+// ms_hint and mine_probabilities only look at the numbers next to the frontier (and the tiles
+// solve_map changes) instead of the whole map.  mine_probabilities still writes a chance for
+// every tile, and a hint that falls back to a tile no number touches looks for one across the
+// map (within its time limit).  The map's planes mustn't be changed any other way while it's
+// tracked.  Tracking again does nothing.
+// Returns 0, or -1 if it runs out of memory (the map is then left untracked)
+int frontier_track (Board * map);
+
+// frontier_untrack
+//   Board * map
+// Stops tracking the map's frontier and frees it (free_map and ms_free do this too)
+void frontier_untrack (Board * map);
+
+// frontier_tiles -> int
+//   const Board * map: map whose frontier is tracked
+//   const size_t ** tiles: output, the tile_index of every tile on the frontier, once each and in
+//                          no particular order (valid until the map next changes)
+//   size_t * count: output, the number of tiles
+// Takes time in proportion to the frontier, not to the map.
+// Returns 0, or -1 if it runs out of memory
+int frontier_tiles (const Board * map, const size_t ** tiles, size_t * count);
+
+// count_hidden
+//   const Board * map
+//   long long * hidden: output, the number of hidden, unmarked tiles
+//   long long * marked: output, the number of marked tiles
+// Takes O(1) if the map's frontier is tracked (it keeps count), otherwise one pass over the planes
+void count_hidden (const Board * map, long long * hidden, long long * marked);
+
+// reveal_tile -> int
+//   int column: column of revealed tile (starts at 0)
+//   int row: row of revealed tile (starts at 0)
+//   long long * score: pointer to score variable
+//   Board * map: pointer to map
+// If the tile is a mine, returns 1 without changing anything
+// If the tile is not a mine, it
+//      * if it's already open, it does nothing
+//      * otherwise, it flips the tile to open (and removes its mark)
+//      * if it has no surrounding mines, it flips the neighboring tiles, and theirs if they have none either, ...
+//      * otherwise, it stops
+//      * increments score whenever a tile is flipped.
+//   and returns 0 (or -1 if it ran out of memory part way through)
+// Uses a worklist instead of recursion, so the stack usage doesn't grow with the size of the
+// opening and each tile is looked at a bounded number of times.
+int reveal_tile (int column, int row, long long * score, Board * map);
+
+// reveal_tile_changes -> int
+//   int column, int row, long long * score, Board * map: see reveal_tile
+//   MsChanges * changes: every tile it flips is added to the end of the list, in the order they
+//                        were flipped (set count to 0 first to only get these), or out_of_memory
+//                        is set if the list can't grow
+// Same as reveal_tile, but also says which tiles the opening reached, so they don't have to be
+// looked for on the map
+int reveal_tile_changes (int column, int row, long long * score, Board * map, MsChanges * changes);
+
+// reveal_map
+//   Board * map
+// Reveals the entire map (including the mines) and removes all of the marks
+void reveal_map (Board * map);
+
+// int mark_tile
+//   int row
+//   int column
+//   Board * map
+// If the tile is hidden, marks the tile (or unmarks it if it's already marked).
+// Returns 1 if the tile has already been revealed, 0 if it was marked/unmarked or -100 if the row, column is out of range
+int mark_tile (int row, int column, Board * map);
+
+#endif
@@ -0,0 +1,220 @@
+// Move journal (see ms_journal.h)
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms_journal.h"
+#include "ms_solver.h"
+
+// Most bytes a varint can take
+#define MAX_VARINT 10
+
+// Milliseconds since some fixed point in the past
+static long long now_ms (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// Store a number as a varint
+// Returns the number of bytes used
+static int put_varint (unsigned char * out, uint64_t value)
+{
+    int length = 0;
+    while (value >= 0x80)
+    {
+        out[length ++] = value | 0x80;
+        value >>= 7;
+    }
+    out[length ++] = value;
+    return length;
+}
+
+// Read a varint, moving *position past it
+// Returns 0, or 1 if the data ends part way through it (or it's too long)
+static int get_varint (const unsigned char * data, size_t length, size_t * position, uint64_t * value)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && *position < length; shift += 7)
+    {
+        unsigned char byte = data[(*position) ++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            *value = result;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Signed numbers as varints: 0, -1, 1, -2, 2, ... become 0, 1, 2, 3, 4, ...
+static uint64_t zigzag (long long value)
+{
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+static long long unzigzag (uint64_t value)
+{
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+// Record a move (the game's on_move hook)
+static void record_move (void * data, int mark, int row, int column)
+{
+    Journal * journal = data;
+    long long time = now_ms();
+    unsigned char record[3 * MAX_VARINT];
+    int length = put_varint(record, zigzag(row - journal->row) << 1 | mark);
+    length += put_varint(record + length, zigzag(column - journal->column));
+    length += put_varint(record + length, time - journal->time);
+    fwrite(record, 1, length, journal->file);
+    fflush(journal->file); // so a crash loses nothing before it
+
+    journal->row = row;
+    journal->column = column;
+    journal->time = time;
+}
+
+int journal_start (Journal * journal, FILE * file, Game * game, int no_guess, int row, int column)
+{
+    unsigned char header[3 + 8 * MAX_VARINT];
+    int length = 3;
+    memcpy(header, "MSJ", 3);
+    length += put_varint(header + length, JOURNAL_VERSION);
+    length += put_varint(header + length, game->seed);
+    length += put_varint(header + length, game->width);
+    length += put_varint(header + length, game->height);
+    length += put_varint(header + length, game->num_mines);
+    length += put_varint(header + length, no_guess != 0);
+    if (no_guess)
+    {
+        length += put_varint(header + length, row);
+        length += put_varint(header + length, column);
+    }
+    if (fwrite(header, 1, length, file) != (size_t)length || fflush(file) != 0) return -1;
+
+    journal->file = file;
+    journal->row = 0;
+    journal->column = 0;
+    journal->time = now_ms();
+    game->on_move = record_move;
+    game->on_move_data = journal;
+    return 0;
+}
+
+int journal_replay (const unsigned char * data, size_t length, Game ** game, JournalInfo * info)
+{
+    *game = NULL;
+    if (length < 3 || memcmp(data, "MSJ", 3) != 0) return 1;
+
+    // Header
+    size_t position = 3;
+    uint64_t version, seed, width, height, num_mines, no_guess, first_row = 0, first_column = 0;
+    if (get_varint(data, length, &position, &version) || version != JOURNAL_VERSION
+        || get_varint(data, length, &position, &seed) || get_varint(data, length, &position, &width)
+        || get_varint(data, length, &position, &height) || get_varint(data, length, &position, &num_mines)
+        || get_varint(data, length, &position, &no_guess)
+        || (no_guess && (get_varint(data, length, &position, &first_row) || get_varint(data, length, &position, &first_column))))
+        return 1;
+    if (width == 0 || height == 0 || width > 1 << 30 || height > 1 << 30 || num_mines > width * height) return 1;
+
+    // The same settings always make the same map
+    Game * replay = no_guess ? ms_new_no_guess(width, height, num_mines, seed, first_row, first_column, 0)
+                             : ms_new(width, height, num_mines, seed);
+    if (replay == NULL) return no_guess ? 1 : -1;
+
+    // Moves
+    Board * map = &replay->map;
+    long long row = 0, column = 0;
+    JournalInfo played = { 0, 0, 0 };
+    int result = 0;
+    while (position < length)
+    {
+        uint64_t first, second, delay;
+        if (get_varint(data, length, &position, &first) || get_varint(data, length, &position, &second)
+            || get_varint(data, length, &position, &delay))
+            break; // cut short while being written
+
+        int mark = first & 1;
+        row += unzigzag(first >> 1);
+        column += unzigzag(second);
+        if (row < 0 || column < 0 || row >= replay->height || column >= replay->width)
+        {
+            result = 1;
+            break;
+        }
+        played.moves ++;
+        played.duration += delay;
+
+        // The same as ms_reveal and ms_mark without the checks that were done when it was played
+        if (mark)
+        {
+            played.marks ++;
+            mark_tile(row, column, map);
+            continue;
+        }
+        long long old_score = replay->score;
+        int revealed = reveal_tile(column, row, &replay->score, map);
+        if (revealed == 1)
+        {
+            replay->status = MS_LOST;
+            break;
+        }
+        replay->free_positions -= replay->score - old_score;
+        if (replay->free_positions <= 0)
+        {
+            replay->status = MS_WON;
+            break;
+        }
+        if (revealed < 0)
+        {
+            result = -1;
+            break;
+        }
+    }
+
+    if (result != 0)
+    {
+        ms_free(replay);
+        return result;
+    }
+    *game = replay;
+    if (info != NULL) *info = played;
+    return 0;
+}
+
+int journal_replay_file (const char * path, Game ** game, JournalInfo * info)
+{
+    *game = NULL;
+    FILE * file = fopen(path, "rb");
+    if (file == NULL) return -1;
+
+    // Read the whole file (journals are a few bytes per move)
+    size_t length = 0, capacity = 1 << 16;
+    unsigned char * data = malloc(capacity);
+    while (data != NULL)
+    {
+        length += fread(data + length, 1, capacity - length, file);
+        if (length < capacity) break;
+        unsigned char * bigger = realloc(data, capacity * 2);
+        if (bigger == NULL)
+        {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = bigger;
+        capacity *= 2;
+    }
+    int failed = ferror(file);
+    fclose(file);
+    if (data == NULL || failed)
+    {
+        free(data);
+        return -1;
+    }
+
+    int result = journal_replay(data, length, game, info);
+    free(data);
+    return result;
+}
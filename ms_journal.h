@@ -0,0 +1,68 @@
+// Move journal
+// Records every reveal and mark of a game in a small append-only file, so the game can be played
+// back exactly later (to look at how games are played, or to reproduce a bug).  A journal is
+// a header saying how the map was made, then one record per move:
+//
+//      header      "MSJ", version, seed, width, height, number of mines, how the map was made
+//                  (0 = ms_new, 1 = ms_new_no_guess) and, for no-guess maps, the first move
+//      each move   (row - previous row) * 2 + mark, column - previous column, milliseconds since
+//                  the previous move
+//
+// Every number is a varint (7 bits per byte, low bits first, top bit set on all but the last
+// byte) and the differences are zigzag encoded, so a move next to the last one takes 3 bytes.
+// A record cut short at the end of the file (e.g. by a crash) is ignored.
+#ifndef MS_JOURNAL_H
+#define MS_JOURNAL_H
+#include <stdio.h>
+#include "ms_engine.h"
+
+#define JOURNAL_VERSION 1
+
+// A journal being written
+typedef struct
+{
+    FILE * file;
+    int row;                // previous move
+    int column;
+    long long time;         // time of the previous move (milliseconds)
+} Journal;
+
+// What was in a journal that was played back
+typedef struct
+{
+    long long moves;        // number of moves played
+    long long marks;        // how many of them were marks
+    long long duration;     // milliseconds between the start of the journal and the last move
+} JournalInfo;
+
+// journal_start -> int
+//   Journal * journal
+//   FILE * file: file to write the journal to (opened for writing in binary mode)
+//   Game * game: a game nobody has moved in yet
+//   int no_guess: whether the game was made by ms_new_no_guess
+//   int row, int column: the first move given to ms_new_no_guess (ignored otherwise)
+// Writes the header and hooks the game (see on_move in Game) so every move is recorded.  The
+// journal is flushed after every move.  The file is left open for the caller to close after
+// the game is freed.
+// Returns 0, or -1 if the header couldn't be written
+int journal_start (Journal * journal, FILE * file, Game * game, int no_guess, int row, int column);
+
+// journal_replay -> int
+//   const unsigned char * data: the whole journal
+//   size_t length
+//   Game ** game: set to the game as it was after the last move (free it with ms_free)
+//   JournalInfo * info: filled in with what was played (may be NULL)
+// Makes the map again from the header and plays every move straight through reveal_tile and
+// mark_tile, without drawing anything or waiting between moves.
+// Returns 0, 1 if it isn't a journal (or has a move that isn't on the map), or -1 if it runs
+// out of memory.
+int journal_replay (const unsigned char * data, size_t length, Game ** game, JournalInfo * info);
+
+// journal_replay_file -> int
+//   const char * path: journal written by journal_start
+//   Game ** game, JournalInfo * info: see journal_replay
+// Reads a journal file and plays it back.
+// Returns 0, 1 if it isn't a journal, or -1 if it can't be read or runs out of memory.
+int journal_replay_file (const char * path, Game ** game, JournalInfo * info);
+
+#endif
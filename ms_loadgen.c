@@ -0,0 +1,255 @@
+// Load generator for the Minesweeper server (see ms_server.h)
+// Compile: gcc -O2 -pthread ms_loadgen.c ms_server.c ms_engine.c ms_boxsum.c -o ms_loadgen
+// Run: ./ms_loadgen ADDRESS [--connections N] [--seconds S] [--size WIDTH HEIGHT MINES]
+//
+// Opens N connections (default 64) to the server and keeps one request in flight on each, all
+// from one epoll loop.  Each connection starts a game, reveals random tiles (and marks one in
+// ten) until the game is over, frees the game and starts another.  After S seconds (default 5)
+// it prints how many moves (reveals and marks) per second the server kept up and the latency
+// percentiles of every request, from sending it to reading the whole reply.
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "ms_engine.h"
+#include "ms_server.h"
+
+// One connection to the server
+typedef struct
+{
+    int fd;
+    long long game;         // game being played (0 = a new one has been asked for)
+    int freeing;            // whether the request in flight frees the game
+    double sent;            // when the request in flight was sent
+    char in[SERVER_MAX_LINE]; // start of the reply
+    size_t in_length;
+} Client;
+
+// Settings for the games
+static int width = 30, height = 16, num_mines = 99;
+
+// Latency of every request so far (microseconds)
+static double * latencies;
+static size_t num_latencies, latencies_capacity;
+
+// Current time in nanoseconds
+static double now_ns (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_doubles (const void * a, const void * b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Value below which a fraction p of the sorted values fall
+static double percentile (const double * sorted, size_t count, double p)
+{
+    return sorted[(size_t)(p * (count - 1) + 0.5)];
+}
+
+static void add_latency (double latency)
+{
+    if (num_latencies == latencies_capacity)
+    {
+        latencies_capacity = latencies_capacity > 0 ? latencies_capacity * 2 : 1 << 16;
+        latencies = realloc(latencies, sizeof(double) * latencies_capacity);
+        if (latencies == NULL)
+        {
+            printf("ERROR: Not enough memory for the latencies\n");
+            exit(1);
+        }
+    }
+    latencies[num_latencies ++] = latency;
+}
+
+// Send a request (small enough to never have to wait for room in the socket)
+static void send_request (Client * client, const char * request)
+{
+    size_t length = strlen(request);
+    client->sent = now_ns();
+    if (write(client->fd, request, length) != (ssize_t)length)
+    {
+        printf("ERROR: Lost the connection to the server\n");
+        exit(1);
+    }
+}
+
+// Send the next move of a client's game
+static void send_move (Client * client, Rng * rng)
+{
+    char request[96];
+    snprintf(request, sizeof(request), "%s %lld %d %d\n", rng_below(rng, 10) == 0 ? "mark" : "reveal",
+             client->game, (int)rng_below(rng, height), (int)rng_below(rng, width));
+    send_request(client, request);
+}
+
+static void send_new (Client * client, Rng * rng)
+{
+    char request[96];
+    snprintf(request, sizeof(request), "new %d %d %d %llu\n", width, height, num_mines, (unsigned long long)rng_next(rng));
+    client->game = 0;
+    send_request(client, request);
+}
+
+// Act on a whole reply and send the next request, unless stopping
+// Returns 1 if the reply was to a move
+static int handle_reply (Client * client, const char * reply, Rng * rng, int stopping)
+{
+    add_latency((now_ns() - client->sent) / 1e3);
+    if (strncmp(reply, "OK", 2) != 0)
+    {
+        printf("ERROR: The server said: %s\n", reply);
+        exit(1);
+    }
+
+    int move = 0;
+    char status[16] = "";
+    if (client->freeing)
+    {
+        client->freeing = 0;
+        client->game = 0;
+    }
+    else if (client->game == 0)
+        sscanf(reply, "OK %lld", &client->game);
+    else
+    {
+        sscanf(reply, "OK %*s %15s", status);
+        move = 1;
+    }
+    if (stopping) return move;
+
+    if (move && strcmp(status, "playing") != 0)
+    {
+        char request[64];
+        snprintf(request, sizeof(request), "free %lld\n", client->game);
+        client->freeing = 1;
+        send_request(client, request);
+    }
+    else if (client->game == 0)
+        send_new(client, rng);
+    else
+        send_move(client, rng);
+    return move;
+}
+
+int main (int argc, char * argv[])
+{
+    const char * address = NULL;
+    int num_clients = 64;
+    double seconds = 5;
+    int wrong = 0;
+    for (int i = 1; i < argc; i ++)
+    {
+        if (strcmp(argv[i], "--connections") == 0 && i + 1 < argc)
+            num_clients = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 3 < argc)
+        {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+            num_mines = atoi(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && address == NULL)
+            address = argv[i];
+        else
+            wrong = 1;
+    }
+    if (wrong || address == NULL || num_clients < 1 || seconds <= 0 || width < 1 || height < 1)
+    {
+        printf("Usage: %s ADDRESS [--connections N] [--seconds S] [--size WIDTH HEIGHT MINES]\n", argv[0]);
+        return 1;
+    }
+
+    Rng rng;
+    rng_seed(&rng, rng_time_seed());
+    int epoll_fd = epoll_create1(0);
+    Client * clients = calloc(num_clients, sizeof(Client));
+    if (epoll_fd < 0 || clients == NULL)
+    {
+        printf("ERROR: Could not start\n");
+        return 1;
+    }
+    for (int i = 0; i < num_clients; i ++)
+    {
+        clients[i].fd = server_connect(address);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = &clients[i];
+        if (clients[i].fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &event) != 0)
+        {
+            printf("ERROR: Could not connect to %s: %s\n", address, strerror(errno));
+            return 1;
+        }
+    }
+
+    // Every client starts with a new game, then keeps exactly one request in flight
+    double start = now_ns();
+    double end = start + seconds * 1e9;
+    for (int i = 0; i < num_clients; i ++) send_new(&clients[i], &rng);
+    long long moves = 0;
+    int in_flight = num_clients;
+    while (in_flight > 0)
+    {
+        struct epoll_event events[64];
+        int count = epoll_wait(epoll_fd, events, 64, 1000);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0)
+        {
+            printf("ERROR: The server stopped answering\n");
+            return 1;
+        }
+        int stopping = now_ns() >= end;
+
+        for (int i = 0; i < count; i ++)
+        {
+            Client * client = events[i].data.ptr;
+            ssize_t got = read(client->fd, client->in + client->in_length, sizeof(client->in) - client->in_length);
+            if (got <= 0)
+            {
+                printf("ERROR: Lost the connection to the server\n");
+                return 1;
+            }
+            client->in_length += got;
+
+            // Only ever one reply, since there's only one request in flight
+            char * newline = memchr(client->in, '\n', client->in_length);
+            if (newline == NULL)
+            {
+                if (client->in_length == sizeof(client->in)) // e.g. the reply to a state request
+                {
+                    printf("ERROR: Reply too long\n");
+                    return 1;
+                }
+                continue;
+            }
+            *newline = '\0';
+            moves += handle_reply(client, client->in, &rng, stopping);
+            client->in_length = 0;
+            if (stopping) in_flight --;
+        }
+    }
+    double elapsed = (now_ns() - start) / 1e9;
+
+    qsort(latencies, num_latencies, sizeof(double), compare_doubles);
+    printf("%zu requests from %d connections in %.2f s (%d x %d, %d mines)\n", num_latencies, num_clients, elapsed, width, height, num_mines);
+    printf("moves: %lld (%.0f moves/s)\n", moves, moves / elapsed);
+    printf("latency (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           percentile(latencies, num_latencies, 0.5), percentile(latencies, num_latencies, 0.9),
+           percentile(latencies, num_latencies, 0.99), percentile(latencies, num_latencies, 0.999),
+           latencies[num_latencies - 1]);
+
+    for (int i = 0; i < num_clients; i ++) close(clients[i].fd);
+    free(clients);
+    free(latencies);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// No-guess map generation (see ms_new_no_guess in ms_solver.h)
+//
+// Candidate maps are numbered 0, 1, 2, ... and candidate n always comes from the same seed, so
+// the search is a race to find the lowest numbered candidate the solver can finish.  Worker
+// threads take the next candidate number from a shared counter and stop taking new ones once a
+// lower numbered candidate has been found, so the answer doesn't depend on the number of
+// threads or on which thread gets there first.
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "ms_solver.h"
+
+// Shared state of one search
+typedef struct
+{
+    int width;
+    int height;
+    long long num_mines;
+    uint64_t seed;
+    int row;
+    int column;
+
+    pthread_mutex_t lock;
+    long long next;         // next candidate to hand out
+    long long found;        // lowest candidate found so far that doesn't need a guess
+    int out_of_memory;
+} NoGuessSearch;
+
+// Seed of a candidate map
+static uint64_t candidate_seed (uint64_t seed, long long candidate)
+{
+    uint64_t x = seed;
+    return rng_splitmix64(&x) + (uint64_t)candidate;
+}
+
+// Take candidates until one is found (by this thread or another one)
+static void * no_guess_worker (void * data)
+{
+    NoGuessSearch * search = data;
+    for (;;)
+    {
+        pthread_mutex_lock(&search->lock);
+        long long candidate = search->next;
+        int stop = candidate >= search->found || search->out_of_memory;
+        if (!stop) search->next ++;
+        pthread_mutex_unlock(&search->lock);
+        if (stop) break;
+
+        Game * game = ms_new_at(search->width, search->height, search->num_mines,
+                                candidate_seed(search->seed, candidate), search->row, search->column);
+        SolveResult result = game == NULL ? SOLVE_NO_MEMORY : ms_solve(game);
+        ms_free(game);
+
+        if (result == SOLVE_WON || result == SOLVE_NO_MEMORY)
+        {
+            pthread_mutex_lock(&search->lock);
+            if (result == SOLVE_NO_MEMORY) search->out_of_memory = 1;
+            else if (candidate < search->found) search->found = candidate;
+            pthread_mutex_unlock(&search->lock);
+        }
+    }
+    return NULL;
+}
+
+Game * ms_new_no_guess (int width, int height, long long num_mines, uint64_t seed, int row, int column, int threads)
+{
+    if (width <= 0 || height <= 0 || row < 0 || column < 0 || row >= height || column >= width) return NULL;
+
+    NoGuessSearch search;
+    search.width = width;
+    search.height = height;
+    search.num_mines = num_mines;
+    search.seed = seed;
+    search.row = row;
+    search.column = column;
+    search.next = 0;
+    search.found = NO_GUESS_ATTEMPTS;
+    search.out_of_memory = 0;
+    pthread_mutex_init(&search.lock, NULL);
+
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+
+    // This thread works too, so one fewer thread is started
+    pthread_t * workers = malloc(sizeof(pthread_t) * threads);
+    int started = 0;
+    if (workers != NULL)
+        while (started < threads - 1 && pthread_create(&workers[started], NULL, no_guess_worker, &search) == 0)
+            started ++;
+    no_guess_worker(&search);
+    for (int i = 0; i < started; i ++) pthread_join(workers[i], NULL);
+    free(workers);
+    pthread_mutex_destroy(&search.lock);
+
+    if (search.out_of_memory || search.found >= NO_GUESS_ATTEMPTS) return NULL;
+
+    // Make the winning candidate again for the caller (it's only one more map)
+    Game * game = ms_new_at(width, height, num_mines, candidate_seed(seed, search.found), row, column);
+    if (game != NULL) game->seed = seed;
+    return game;
+}
@@ -0,0 +1,625 @@
+// Exact mine probabilities for the hidden tiles (see mine_probabilities in ms_solver.h)
+//
+// Only the hidden tiles next to an open number (the frontier) are constrained by the numbers;
+// every other hidden tile is interchangeable with the rest.  So:
+//   1. frontier tiles touched by exactly the same numbers are merged into groups, since only
+//      how many mines a group holds matters (a group of g tiles holding m mines stands for
+//      C(g, m) arrangements),
+//   2. groups are split into components that share no numbers, which can be worked out
+//      independently,
+//   3. each component is enumerated with backtracking, counting the arrangements (and the
+//      mines in each group) for every possible number of mines in the component,
+//   4. the components are combined with the mines that are left: an arrangement with s mines
+//      on the frontier leaves C(other tiles, mines left - s) ways to place the rest.
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms_solver.h"
+
+// A hidden tile next to at least one number, and the numbers it is next to
+typedef struct
+{
+    size_t tile;
+    int num_rules;
+    int rules[8];
+} FrontierTile;
+
+// An open number with hidden, unmarked neighbours
+typedef struct
+{
+    int need;           // mines among its hidden, unmarked neighbours
+    int num_tiles;
+    size_t tiles[8];    // its hidden, unmarked neighbours
+    int num_groups;
+    int groups[8];      // the groups they belong to
+} Rule;
+
+// The rules found so far, and every tile they touch (with repeats)
+typedef struct
+{
+    Rule * rules;
+    int num_rules;
+    int rules_capacity;
+    size_t * tiles;
+    int num_tiles;
+    int tiles_capacity;
+} RuleList;
+
+// Frontier tiles that are next to exactly the same numbers
+typedef struct
+{
+    int size;           // number of tiles
+    int num_rules;
+    int rules[8];
+    int component;
+} Group;
+
+// State of the backtracking over one component
+typedef struct
+{
+    const Group * groups;
+    const Rule * rules;
+    const int * order;      // groups of the component, in the order they are assigned
+    int num_groups;         // number of groups in the component
+    int * sum;              // per rule: mines assigned so far
+    int * left;             // per rule: tiles not assigned yet
+    int * mines;            // per group of the component: mines assigned
+    double * counts;        // [k]: arrangements with k mines in the component
+    double * group_mines;   // [k * num_groups + i]: mines in group order[i] over those arrangements
+    double deadline;        // when to give up (0 = never)
+    long long steps;        // groups assigned so far, to only look at the clock now and then
+    int out_of_time;
+} Search;
+
+// Current CLOCK_MONOTONIC time in seconds
+static double now_seconds (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// C(n, k) as a double
+static double binomial (int n, int k)
+{
+    double result = 1;
+    for (int i = 1; i <= k; i ++)
+        result = result * (n - k + i) / i;
+    return result;
+}
+
+// Assign every number of mines each group can hold, depth first
+//   depth: groups assigned so far
+//   total: mines in them
+//   weight: number of arrangements of the tiles in them
+static void search (Search * s, int depth, int total, double weight)
+{
+    if (s->out_of_time) return;
+    if (s->deadline > 0 && ++ s->steps % 4096 == 0 && now_seconds() >= s->deadline)
+    {
+        s->out_of_time = 1;
+        return;
+    }
+
+    if (depth == s->num_groups)
+    {
+        // Every number is satisfied (the last group of each number is forced to fill it)
+        s->counts[total] += weight;
+        double * row = s->group_mines + (size_t)total * s->num_groups;
+        for (int i = 0; i < s->num_groups; i ++)
+            row[i] += weight * s->mines[i];
+        return;
+    }
+
+    // The group can hold anything from lo to hi mines without breaking one of its numbers
+    const Group * group = &s->groups[s->order[depth]];
+    int lo = 0, hi = group->size;
+    for (int i = 0; i < group->num_rules; i ++)
+    {
+        int r = group->rules[i];
+        int still_needed = s->rules[r].need - s->sum[r];
+        int other_tiles = s->left[r] - group->size;
+        if (still_needed - other_tiles > lo) lo = still_needed - other_tiles;
+        if (still_needed < hi) hi = still_needed;
+    }
+
+    for (int m = lo; m <= hi; m ++)
+    {
+        for (int i = 0; i < group->num_rules; i ++)
+        {
+            s->sum[group->rules[i]] += m;
+            s->left[group->rules[i]] -= group->size;
+        }
+        s->mines[depth] = m;
+        search(s, depth + 1, total + m, weight * binomial(group->size, m));
+        for (int i = 0; i < group->num_rules; i ++)
+        {
+            s->sum[group->rules[i]] -= m;
+            s->left[group->rules[i]] += group->size;
+        }
+    }
+}
+
+// Compare the numbers two frontier tiles are next to (0 if they're the same numbers)
+static int compare_rules (const FrontierTile * x, const FrontierTile * y)
+{
+    if (x->num_rules != y->num_rules) return x->num_rules - y->num_rules;
+    for (int i = 0; i < x->num_rules; i ++)
+        if (x->rules[i] != y->rules[i]) return x->rules[i] - y->rules[i];
+    return 0;
+}
+
+// Order frontier tiles by the numbers they are next to, so tiles of the same group end up together
+static int compare_tiles (const void * a, const void * b)
+{
+    const FrontierTile * x = a;
+    const FrontierTile * y = b;
+    int by_rules = compare_rules(x, y);
+    if (by_rules != 0) return by_rules;
+    return x->tile < y->tile ? -1 : x->tile > y->tile;
+}
+
+static int compare_index (const void * a, const void * b)
+{
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Position of a tile in the sorted list of frontier tiles
+static int find_tile (const size_t * tiles, int count, size_t tile)
+{
+    int lo = 0, hi = count - 1;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        if (tiles[mid] < tile) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Union-find over groups
+static int find_root (int * parent, int x)
+{
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+}
+
+// out[0..a_len+b_len-1) = a * b, with anything past max_len dropped
+// Returns the length of out
+static int convolve (const double * a, int a_len, const double * b, int b_len, double * out, int max_len)
+{
+    int len = a_len + b_len - 1;
+    if (len > max_len) len = max_len;
+    for (int i = 0; i < len; i ++) out[i] = 0;
+    for (int i = 0; i < a_len && i < len; i ++)
+        for (int j = 0; j < b_len && i + j < len; j ++)
+            out[i + j] += a[i] * b[j];
+    return len;
+}
+
+// Add the rule of an open tile (if it has hidden, unmarked neighbours) to the list
+// Returns 0, 1 if the number can't be right (too many marks or too few hidden tiles around it),
+// or -1 if it runs out of memory
+static int add_number (const Board * map, size_t index, RuleList * list)
+{
+    int width = map->width;
+    int height = map->height;
+    int row = index / width;
+    int column = index % width;
+
+    Rule rule;
+    rule.need = tile_count(map, index);
+    rule.num_tiles = 0;
+    for (int i = -1; i <= 1; i ++)
+    {
+        for (int j = -1; j <= 1; j ++)
+        {
+            int neighbor_row = row + i;
+            int neighbor_column = column + j;
+            if (neighbor_row < 0 || neighbor_row >= height || neighbor_column < 0 || neighbor_column >= width) continue;
+
+            size_t neighbor = tile_index(map, neighbor_row, neighbor_column);
+            if (test_bit(map->revealed, neighbor)) continue;
+            if (test_bit(map->flags, neighbor)) rule.need --;
+            else rule.tiles[rule.num_tiles ++] = neighbor;
+        }
+    }
+    if (rule.num_tiles == 0) return 0;
+    if (rule.need < 0 || rule.need > rule.num_tiles) return 1;
+
+    if (list->num_rules == list->rules_capacity || list->num_tiles + 8 > list->tiles_capacity)
+    {
+        list->rules_capacity = list->rules_capacity ? list->rules_capacity * 2 : 64;
+        list->tiles_capacity = list->rules_capacity * 8;
+        Rule * bigger_rules = realloc(list->rules, sizeof(Rule) * list->rules_capacity);
+        if (bigger_rules == NULL) return -1;
+        list->rules = bigger_rules;
+        size_t * bigger_tiles = realloc(list->tiles, sizeof(size_t) * list->tiles_capacity);
+        if (bigger_tiles == NULL) return -1;
+        list->tiles = bigger_tiles;
+    }
+    for (int i = 0; i < rule.num_tiles; i ++)
+        list->tiles[list->num_tiles ++] = rule.tiles[i];
+    list->rules[list->num_rules ++] = rule;
+    return 0;
+}
+
+// Add the rules of the open tiles next to a tracked frontier, in the same order as going
+// through the whole map
+// Returns 0, 1 or -1 (see add_number)
+static int add_frontier_numbers (const Board * map, RuleList * list)
+{
+    const size_t * tiles;
+    size_t count;
+    if (frontier_tiles(map, &tiles, &count) != 0) return -1;
+    size_t * numbers = malloc(sizeof(size_t) * (count * 8 + 1));
+    if (numbers == NULL) return -1;
+
+    size_t num_numbers = 0;
+    for (size_t t = 0; t < count; t ++)
+    {
+        int row = tiles[t] / map->width;
+        int column = tiles[t] % map->width;
+        for (int i = -1; i <= 1; i ++)
+        {
+            for (int j = -1; j <= 1; j ++)
+            {
+                int neighbor_row = row + i;
+                int neighbor_column = column + j;
+                if (neighbor_row < 0 || neighbor_row >= map->height || neighbor_column < 0 || neighbor_column >= map->width) continue;
+                size_t neighbor = tile_index(map, neighbor_row, neighbor_column);
+                if (test_bit(map->revealed, neighbor) && !test_bit(map->mines, neighbor)) numbers[num_numbers ++] = neighbor;
+            }
+        }
+    }
+
+    qsort(numbers, num_numbers, sizeof(size_t), compare_index);
+    int result = 0;
+    for (size_t i = 0; i < num_numbers && result == 0; i ++)
+        if (i == 0 || numbers[i] != numbers[i - 1]) result = add_number(map, numbers[i], list);
+    free(numbers);
+    return result;
+}
+
+int mine_probabilities (const Board * map, long long num_mines, double * probability)
+{
+    return mine_probabilities_until(map, num_mines, probability, 0);
+}
+
+int mine_probabilities_until (const Board * map, long long num_mines, double * probability, double deadline)
+{
+    if (map->layout != LAYOUT_ROWS) return -1; // probability is row by row, like the planes
+    int width = map->width;
+    int height = map->height;
+    size_t tiles = (size_t)width * height;
+    size_t words = (tiles + 63) / 64;
+    int status = -1;
+
+    // Everything that gets allocated (freed together at the end)
+    size_t * frontier = NULL;
+    FrontierTile * frontier_tiles = NULL;
+    Rule * rules = NULL;
+    Group * groups = NULL;
+    int * group_of = NULL, * parent = NULL, * order = NULL, * component_start = NULL;
+    int * sum = NULL, * left = NULL, * mines = NULL;
+    double * counts = NULL, * group_mines = NULL, * group_probability = NULL, * prefix = NULL, * suffix = NULL, * others = NULL, * weights = NULL;
+    size_t * count_offset = NULL, * group_mines_offset = NULL;
+
+    // Hidden, unmarked tiles and the mines left for them (marks are taken to be mines)
+    long long hidden, marked;
+    count_hidden(map, &hidden, &marked);
+    long long mines_left = num_mines - marked;
+
+    // 1. The numbers and their hidden neighbours.  With a tracked frontier only the numbers
+    // next to it are looked at, otherwise every open tile.
+    RuleList list = { 0 };
+    int found = 0;
+    if (map->frontier != NULL)
+        found = add_frontier_numbers(map, &list);
+    else
+    {
+        for (size_t word = 0; word < words && found == 0; word ++)
+        {
+            for (uint64_t bits = map->revealed[word] & ~map->mines[word]; bits != 0 && found == 0; bits &= bits - 1)
+            {
+                size_t index = word * 64 + __builtin_ctzll(bits);
+                if (index >= tiles) break;
+                found = add_number(map, index, &list);
+            }
+        }
+    }
+    rules = list.rules;
+    int num_rules = list.num_rules;
+    frontier = list.tiles;
+    int num_frontier = list.num_tiles;
+    if (found != 0)
+    {
+        status = found;
+        goto done;
+    }
+
+    // The frontier is every tile some number touches (sorted, without repeats)
+    int num_listed = num_frontier;
+    qsort(frontier, num_listed, sizeof(size_t), compare_index);
+    num_frontier = 0;
+    for (int i = 0; i < num_listed; i ++)
+        if (num_frontier == 0 || frontier[num_frontier - 1] != frontier[i])
+            frontier[num_frontier ++] = frontier[i];
+    long long others_count = hidden - num_frontier;
+
+    // Which numbers each frontier tile is next to (rules are found in order, so the lists are sorted)
+    frontier_tiles = malloc(sizeof(FrontierTile) * (num_frontier + 1));
+    group_of = malloc(sizeof(int) * (num_frontier + 1));
+    if (frontier_tiles == NULL || group_of == NULL) goto done;
+    for (int i = 0; i < num_frontier; i ++)
+    {
+        frontier_tiles[i].tile = frontier[i];
+        frontier_tiles[i].num_rules = 0;
+    }
+    for (int r = 0; r < num_rules; r ++)
+    {
+        for (int i = 0; i < rules[r].num_tiles; i ++)
+        {
+            FrontierTile * tile = &frontier_tiles[find_tile(frontier, num_frontier, rules[r].tiles[i])];
+            tile->rules[tile->num_rules ++] = r;
+        }
+    }
+
+    // 2. Groups: frontier tiles next to exactly the same numbers
+    qsort(frontier_tiles, num_frontier, sizeof(FrontierTile), compare_tiles);
+    groups = malloc(sizeof(Group) * (num_frontier + 1));
+    if (groups == NULL) goto done;
+    int num_groups = 0;
+    for (int i = 0; i < num_frontier; i ++)
+    {
+        if (i == 0 || compare_rules(&frontier_tiles[i - 1], &frontier_tiles[i]) != 0)
+        {
+            Group * group = &groups[num_groups ++];
+            group->size = 0;
+            group->num_rules = frontier_tiles[i].num_rules;
+            memcpy(group->rules, frontier_tiles[i].rules, sizeof(int) * group->num_rules);
+        }
+        groups[num_groups - 1].size ++;
+        group_of[i] = num_groups - 1;
+    }
+
+    // Each number's list of groups
+    for (int r = 0; r < num_rules; r ++) rules[r].num_groups = 0;
+    for (int g = 0; g < num_groups; g ++)
+    {
+        for (int i = 0; i < groups[g].num_rules; i ++)
+        {
+            Rule * rule = &rules[groups[g].rules[i]];
+            rule->groups[rule->num_groups ++] = g;
+        }
+    }
+
+    // 3. Components: groups joined by shared numbers
+    parent = malloc(sizeof(int) * (num_groups + 1));
+    order = malloc(sizeof(int) * (num_groups + 1));
+    component_start = malloc(sizeof(int) * (num_groups + 2));
+    if (parent == NULL || order == NULL || component_start == NULL) goto done;
+    for (int g = 0; g < num_groups; g ++) parent[g] = g;
+    for (int r = 0; r < num_rules; r ++)
+        for (int i = 1; i < rules[r].num_groups; i ++)
+            parent[find_root(parent, rules[r].groups[i])] = find_root(parent, rules[r].groups[0]);
+    for (int g = 0; g < num_groups; g ++) groups[g].component = -1;
+
+    // List the groups of each component in breadth first order, so each number's groups are
+    // assigned close together and a broken number is noticed early
+    int num_components = 0, listed = 0;
+    for (int g = 0; g < num_groups; g ++)
+    {
+        if (groups[g].component >= 0) continue;
+        component_start[num_components] = listed;
+        groups[g].component = num_components;
+        order[listed ++] = g;
+        for (int next = component_start[num_components]; next < listed; next ++)
+        {
+            const Group * group = &groups[order[next]];
+            for (int i = 0; i < group->num_rules; i ++)
+            {
+                const Rule * rule = &rules[group->rules[i]];
+                for (int j = 0; j < rule->num_groups; j ++)
+                {
+                    if (groups[rule->groups[j]].component >= 0) continue;
+                    groups[rule->groups[j]].component = num_components;
+                    order[listed ++] = rule->groups[j];
+                }
+            }
+        }
+        num_components ++;
+    }
+    component_start[num_components] = listed;
+
+    // 4. Enumerate each component
+    count_offset = malloc(sizeof(size_t) * (num_components + 1));
+    group_mines_offset = malloc(sizeof(size_t) * (num_components + 1));
+    sum = calloc(num_rules + 1, sizeof(int));
+    left = malloc(sizeof(int) * (num_rules + 1));
+    mines = malloc(sizeof(int) * (num_groups + 1));
+    group_probability = malloc(sizeof(double) * (num_groups + 1));
+    if (count_offset == NULL || group_mines_offset == NULL || sum == NULL || left == NULL || mines == NULL ||
+        group_probability == NULL) goto done;
+
+    // counts for component c live at counts[count_offset[c]] (one per possible number of
+    // mines), and its group mines at group_mines[group_mines_offset[c]]
+    size_t total_counts = 0, total_group_mines = 0;
+    for (int c = 0; c < num_components; c ++)
+    {
+        int size = 0;
+        for (int i = component_start[c]; i < component_start[c + 1]; i ++) size += groups[order[i]].size;
+        count_offset[c] = total_counts;
+        group_mines_offset[c] = total_group_mines;
+        total_counts += size + 1;
+        total_group_mines += (size_t)(size + 1) * (component_start[c + 1] - component_start[c]);
+    }
+    count_offset[num_components] = total_counts;
+    counts = calloc(total_counts + 1, sizeof(double));
+    group_mines = calloc(total_group_mines + 1, sizeof(double));
+    if (counts == NULL || group_mines == NULL) goto done;
+
+    for (int r = 0; r < num_rules; r ++)
+    {
+        left[r] = 0;
+        for (int i = 0; i < rules[r].num_groups; i ++) left[r] += groups[rules[r].groups[i]].size;
+    }
+    for (int c = 0; c < num_components; c ++)
+    {
+        Search s;
+        s.groups = groups;
+        s.rules = rules;
+        s.order = order + component_start[c];
+        s.num_groups = component_start[c + 1] - component_start[c];
+        s.sum = sum;
+        s.left = left;
+        s.mines = mines;
+        s.counts = counts + count_offset[c];
+        s.group_mines = group_mines + group_mines_offset[c];
+        s.deadline = deadline;
+        s.steps = 0;
+        s.out_of_time = deadline > 0 && now_seconds() >= deadline;
+        search(&s, 0, 0, 1);
+        if (s.out_of_time)
+        {
+            status = 2;
+            goto done;
+        }
+
+        // Scale so the biggest count is 1 (the scale is the same for every arrangement of the
+        // component, so it cancels out in the end) to keep big components from overflowing
+        int len = count_offset[c + 1] - count_offset[c];
+        double biggest = 0;
+        for (int k = 0; k < len; k ++)
+            if (s.counts[k] > biggest) biggest = s.counts[k];
+        if (biggest == 0)
+        {
+            // No arrangement satisfies the numbers
+            status = 1;
+            goto done;
+        }
+        for (int k = 0; k < len; k ++) s.counts[k] /= biggest;
+        for (size_t i = 0; i < (size_t)len * s.num_groups; i ++) s.group_mines[i] /= biggest;
+    }
+
+    // 5. Combine the components with the mines that are left
+    // weights[s] is proportional to C(others_count, mines_left - s): the ways to place the mines
+    // that aren't on the frontier.  It's built from the ratio between neighbouring values,
+    // scaling everything down whenever it gets big.
+    int max_len = num_frontier + 1;
+    weights = calloc(max_len + 1, sizeof(double));
+    prefix = malloc(sizeof(double) * (size_t)(num_components + 1) * max_len);
+    suffix = malloc(sizeof(double) * (size_t)(num_components + 1) * max_len);
+    others = malloc(sizeof(double) * max_len);
+    int * prefix_len = malloc(sizeof(int) * (num_components + 1) * 2);
+    if (weights == NULL || prefix == NULL || suffix == NULL || others == NULL || prefix_len == NULL)
+    {
+        free(prefix_len);
+        goto done;
+    }
+    int * suffix_len = prefix_len + num_components + 1;
+
+    long long lowest = mines_left - others_count > 0 ? mines_left - others_count : 0;
+    for (long long s = lowest; s < max_len && s <= mines_left; s ++)
+    {
+        if (s == lowest)
+        {
+            weights[s] = 1;
+            continue;
+        }
+        weights[s] = weights[s - 1] * (double)(mines_left - s + 1) / (double)(others_count - mines_left + s);
+        if (weights[s] > 1e200)
+            for (long long t = lowest; t <= s; t ++) weights[t] *= 1e-200;
+    }
+
+    // prefix[c]: mines on components 0..c-1, suffix[c]: mines on components c..last
+    prefix[0] = 1;
+    prefix_len[0] = 1;
+    for (int c = 0; c < num_components; c ++)
+        prefix_len[c + 1] = convolve(prefix + (size_t)c * max_len, prefix_len[c], counts + count_offset[c],
+                                     count_offset[c + 1] - count_offset[c], prefix + (size_t)(c + 1) * max_len, max_len);
+    suffix[(size_t)num_components * max_len] = 1;
+    suffix_len[num_components] = 1;
+    for (int c = num_components - 1; c >= 0; c --)
+        suffix_len[c] = convolve(suffix + (size_t)(c + 1) * max_len, suffix_len[c + 1], counts + count_offset[c],
+                                 count_offset[c + 1] - count_offset[c], suffix + (size_t)c * max_len, max_len);
+
+    // Weight of all arrangements together
+    const double * all = prefix + (size_t)num_components * max_len;
+    double total = 0, other_mines = 0;
+    for (int s = 0; s < prefix_len[num_components]; s ++)
+    {
+        total += all[s] * weights[s];
+        if (mines_left - s > 0) other_mines += all[s] * weights[s] * (mines_left - s);
+    }
+    if (total <= 0)
+    {
+        // The numbers need more mines than are left (or leave too many over)
+        free(prefix_len);
+        status = 1;
+        goto done;
+    }
+
+    // Open tiles are safe, marked tiles are taken to be mines, and tiles off the frontier all
+    // have the same chance
+    double other_probability = others_count > 0 ? other_mines / total / others_count : 0;
+    for (size_t i = 0; i < tiles; i ++)
+        probability[i] = test_bit(map->revealed, i) ? 0 : test_bit(map->flags, i) ? 1 : other_probability;
+
+    for (int c = 0; c < num_components; c ++)
+    {
+        // others[s]: weight of s mines on every other component
+        int others_len = convolve(prefix + (size_t)c * max_len, prefix_len[c], suffix + (size_t)(c + 1) * max_len,
+                                  suffix_len[c + 1], others, max_len);
+        int len = count_offset[c + 1] - count_offset[c];
+        int component_groups = component_start[c + 1] - component_start[c];
+        const double * group_row = group_mines + group_mines_offset[c];
+
+        for (int i = 0; i < component_groups; i ++) group_probability[order[component_start[c] + i]] = 0;
+        for (int k = 0; k < len; k ++)
+        {
+            // Weight of every way to finish an arrangement with k mines on this component
+            double rest = 0;
+            for (int s = 0; s < others_len && k + s < max_len; s ++)
+                rest += others[s] * weights[k + s];
+            for (int i = 0; i < component_groups; i ++)
+                group_probability[order[component_start[c] + i]] += group_row[(size_t)k * component_groups + i] * rest;
+        }
+        for (int i = 0; i < component_groups; i ++)
+        {
+            int g = order[component_start[c] + i];
+            group_probability[g] /= total * groups[g].size;
+        }
+    }
+
+    // Hand each group's chance to its tiles
+    for (int t = 0; t < num_frontier; t ++)
+        probability[frontier_tiles[t].tile] = group_probability[group_of[t]];
+    free(prefix_len);
+    status = 0;
+
+done:
+    free(frontier);
+    free(frontier_tiles);
+    free(rules);
+    free(groups);
+    free(group_of);
+    free(parent);
+    free(order);
+    free(component_start);
+    free(sum);
+    free(left);
+    free(mines);
+    free(counts);
+    free(group_mines);
+    free(group_probability);
+    free(prefix);
+    free(suffix);
+    free(others);
+    free(weights);
+    free(count_offset);
+    free(group_mines_offset);
+    return status;
+}
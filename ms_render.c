@@ -0,0 +1,372 @@
+// Terminal renderer (see ms_render.h)
+// Uses ANSI escape codes, which every terminal emulator (including the Windows 10 console)
+// understands:
+//      ESC[H       cursor to the top left        ESC[2J   clear the screen
+//      ESC[r;cH    cursor to line r, column c    ESC[K    clear to the end of the line
+//      ESC[J       clear to the end of the screen
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include "ms_render.h"
+
+// Most characters a tile can take in a frame (a heatmap tile is a colour, its character, the
+// colour reset and 3 spaces; a changed tile is a cursor move and its character)
+#define MAX_CELL 24
+
+// Value of a tile, the index into the table of cells
+static int tile_value (const Board * map, size_t index)
+{
+    return tile_count(map, index) | test_bit(map->mines, index) << 4
+         | test_bit(map->revealed, index) << 5 | test_bit(map->flags, index) << 6;
+}
+
+// Character a tile with this value is drawn as (the same as draw_tile without a heatmap)
+static char value_glyph (int value)
+{
+    int count = value & 0xF;
+    if (value & 64) // Hidden Tile Marked as Potential Mine
+        return '?';
+    if (!(value & 32)) // Hidden Tile
+        return '.';
+    if (value & 16) // Revealed Mines
+        return '#';
+    return count > 0 ? '0' + count : ' ';
+}
+
+// Size of the terminal, or 0 x 0 if it can't be found out
+static void screen_size (FILE * out, int * rows, int * columns)
+{
+    struct winsize size;
+    if (ioctl(fileno(out), TIOCGWINSZ, &size) == 0)
+    {
+        *rows = size.ws_row;
+        *columns = size.ws_col;
+    }
+    else
+    {
+        *rows = 0;
+        *columns = 0;
+    }
+}
+
+void render_init (Renderer * renderer, FILE * out)
+{
+    renderer->out = out;
+    renderer->width = 0;
+    renderer->height = 0;
+    renderer->top = 0;
+    renderer->screen_rows = 0;
+    renderer->screen_columns = 0;
+    renderer->glyphs = NULL;
+    renderer->full = 1;
+    renderer->printed_lines = 0;
+    renderer->printed_column = 0;
+
+    for (int value = 0; value < 128; value ++)
+    {
+        renderer->cells[value][0] = value_glyph(value);
+        memset(renderer->cells[value] + 1, ' ', 3);
+    }
+    renderer->buffer = NULL;
+    renderer->length = 0;
+    renderer->capacity = 0;
+    renderer->column_numbers = NULL;
+    renderer->column_numbers_length = 0;
+    renderer->numbers_width = 0;
+    renderer->row_numbers = NULL;
+    renderer->numbers_height = 0;
+}
+
+void render_free (Renderer * renderer)
+{
+    free(renderer->glyphs);
+    free(renderer->buffer);
+    free(renderer->column_numbers);
+    free(renderer->row_numbers);
+    render_init(renderer, renderer->out);
+}
+
+void render_reset (Renderer * renderer)
+{
+    renderer->full = 1;
+}
+
+void render_printed (Renderer * renderer, const char * text)
+{
+    for (const char * c = text; *c != '\0'; c ++)
+    {
+        if (*c == '\n')
+        {
+            renderer->printed_lines ++;
+            renderer->printed_column = 0;
+        }
+        else if (*c == '\r')
+            renderer->printed_column = 0;
+        else
+        {
+            // The terminal only goes on to the next line when a character doesn't fit on this one
+            if (renderer->printed_column == renderer->screen_columns && renderer->screen_columns > 0)
+            {
+                renderer->printed_lines ++;
+                renderer->printed_column = 0;
+            }
+            renderer->printed_column ++;
+        }
+    }
+}
+
+// Make room for at least `extra` more characters in the frame
+// Returns 0, or -1 if it runs out of memory
+static int reserve (Renderer * renderer, size_t extra)
+{
+    if (renderer->length + extra <= renderer->capacity) return 0;
+
+    size_t capacity = renderer->capacity > 0 ? renderer->capacity : 4096;
+    while (capacity < renderer->length + extra) capacity *= 2;
+    char * bigger = realloc(renderer->buffer, capacity);
+    if (bigger == NULL) return -1;
+    renderer->buffer = bigger;
+    renderer->capacity = capacity;
+    return 0;
+}
+
+// Add characters to the frame (there must already be room for them, see reserve)
+static void append (Renderer * renderer, const char * text, size_t length)
+{
+    memcpy(renderer->buffer + renderer->length, text, length);
+    renderer->length += length;
+}
+
+// Write the frame in one go and start a new one
+static void flush_frame (Renderer * renderer)
+{
+    fflush(renderer->out); // anything printed before the frame has to come first
+    const char * data = renderer->buffer;
+    size_t left = renderer->length;
+    while (left > 0)
+    {
+        ssize_t written = write(fileno(renderer->out), data, left);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) break;
+        data += written;
+        left -= written;
+    }
+    renderer->length = 0;
+}
+
+// Format the row and column numbers for the size of the map, unless they already are
+// Returns 0, or -1 if it runs out of memory
+static int make_numbers (Renderer * renderer, int width, int height)
+{
+    if (width != renderer->numbers_width)
+    {
+        char * line = malloc(4 + (size_t)width * 12 + 2);
+        if (line == NULL) return -1;
+        size_t length = 4;
+        memset(line, ' ', 4);
+        for (int column = 0; column < width; column ++)
+            length += sprintf(line + length, "C%-3d", column + 1); // same as "%-4s" of "C<column>"
+        memcpy(line + length, "|\n", 2);
+        free(renderer->column_numbers);
+        renderer->column_numbers = line;
+        renderer->column_numbers_length = length + 2;
+        renderer->numbers_width = width;
+    }
+
+    if (height != renderer->numbers_height)
+    {
+        char (*labels)[12] = malloc(sizeof(labels[0]) * height);
+        if (labels == NULL) return -1;
+        for (int row = 0; row < height; row ++)
+            snprintf(labels[row], sizeof(labels[row]), "R%-3d", row + 1);
+        free(renderer->row_numbers);
+        renderer->row_numbers = labels;
+        renderer->numbers_height = height;
+    }
+    return 0;
+}
+
+// Add the whole map in the layout of draw_map: a 4 character cell for every column, plus the
+// row and column numbers and the border
+// If glyphs isn't NULL, the character of every tile is saved in it
+// Returns 0, or -1 if it runs out of memory
+static int build_map (Renderer * renderer, const Board * map, const double * heatmap, long long highlight, char * glyphs)
+{
+    int width = map->width;
+    int height = map->height;
+    if (make_numbers(renderer, width, height) != 0) return -1;
+
+    if (reserve(renderer, renderer->column_numbers_length) != 0) return -1;
+    append(renderer, renderer->column_numbers, renderer->column_numbers_length);
+
+    for (int row = 0; row < height; row ++)
+    {
+        if (reserve(renderer, 12 + (size_t)width * MAX_CELL + 2) != 0) return -1;
+        append(renderer, renderer->row_numbers[row], strlen(renderer->row_numbers[row]));
+
+        size_t index = tile_index(map, row, 0);
+        char * out = renderer->buffer + renderer->length;
+        for (int column = 0; column < width; column ++, index ++)
+        {
+            int value = tile_value(map, index);
+            if (heatmap != NULL && (value & (32 | 64)) == 0) // Hidden Tile on the Heatmap
+            {
+                double chance = heatmap[index];
+                memcpy(out, chance < 0.1 ? "\033[32m" : chance < 0.3 ? "\033[33m" : "\033[31m", 5);
+                out[5] = chance <= 0 ? '+' : chance >= 1 ? '*' : '0' + (int)(chance * 10);
+                memcpy(out + 6, "\033[0m   ", 7);
+                out += 13;
+            }
+            else if ((long long)index == highlight) // the tile is shown in reverse video
+            {
+                memcpy(out, "\033[7m", 4);
+                out[4] = renderer->cells[value][0];
+                memcpy(out + 5, "\033[0m   ", 7);
+                out += 12;
+            }
+            else
+            {
+                memcpy(out, renderer->cells[value], 4);
+                out += 4;
+            }
+            if (glyphs != NULL) glyphs[index] = renderer->cells[value][0];
+        }
+        memcpy(out, "|\n", 2);
+        renderer->length = out + 2 - renderer->buffer;
+    }
+
+    size_t border = 4 * ((size_t)width + 1);
+    if (reserve(renderer, border + 2) != 0) return -1;
+    memset(renderer->buffer + renderer->length, '-', border);
+    renderer->length += border;
+    append(renderer, "+\n", 2);
+    return 0;
+}
+
+// Add only the header and the tiles that changed
+//   int header_lines: number of lines in the header
+// Returns 0, or -1 if it runs out of memory
+static int build_changes (Renderer * renderer, const char * header, int header_lines, const Board * map)
+{
+    int width = map->width;
+    int height = map->height;
+
+    // The header is short, so it's simply written again over the old one (each line clearing
+    // whatever was left after it)
+    if (reserve(renderer, 3 + strlen(header) + 4 * (size_t)header_lines) != 0) return -1;
+    append(renderer, "\033[H", 3);
+    for (const char * line = header; *line != '\0'; )
+    {
+        const char * end = strchr(line, '\n');
+        append(renderer, line, end - line);
+        append(renderer, "\033[K\n", 4);
+        line = end + 1;
+    }
+
+    // Tile (row, column) is on screen line top + 1 + row, column 5 + 4 * column
+    int cursor_row = -1;
+    int cursor_column = -1; // tile the cursor is just after
+    for (int row = 0; row < height; row ++)
+    {
+        size_t index = tile_index(map, row, 0);
+        for (int column = 0; column < width; column ++, index ++)
+        {
+            char glyph = renderer->cells[tile_value(map, index)][0];
+            if (glyph == renderer->glyphs[index]) continue;
+            if (reserve(renderer, MAX_CELL) != 0) return -1;
+            renderer->glyphs[index] = glyph;
+
+            // The next tile along is closer by writing the three spaces between them again
+            if (row == cursor_row && column == cursor_column + 1)
+                append(renderer, "   ", 3);
+            else
+                renderer->length += sprintf(renderer->buffer + renderer->length, "\033[%d;%dH", renderer->top + 1 + row, 5 + 4 * column);
+            renderer->buffer[renderer->length ++] = glyph;
+            cursor_row = row;
+            cursor_column = column;
+        }
+    }
+
+    if (reserve(renderer, MAX_CELL) != 0) return -1;
+    renderer->length += sprintf(renderer->buffer + renderer->length, "\033[%d;1H\033[J", renderer->top + height + 2);
+    return 0;
+}
+
+int render_frame (Renderer * renderer, const char * header, const Board * map)
+{
+    if (map->layout != LAYOUT_ROWS) return -1; // the glyphs go along each row of the planes
+    int width = map->width;
+    int height = map->height;
+
+    int header_lines = 0;
+    for (const char * c = header; *c != '\0'; c ++)
+        if (*c == '\n') header_lines ++;
+
+    // The last frame left the cursor on the line below the map, so if what was printed after it
+    // went past the bottom of the screen, the screen scrolled and the map isn't where it was
+    int rows, columns;
+    screen_size(renderer->out, &rows, &columns);
+    if (rows > 0 && renderer->top + renderer->height + 2 + renderer->printed_lines > rows) renderer->full = 1;
+
+    if (width != renderer->width || height != renderer->height)
+    {
+        char * glyphs = malloc((size_t)width * height);
+        if (glyphs == NULL) return -1;
+        free(renderer->glyphs);
+        renderer->glyphs = glyphs;
+        renderer->width = width;
+        renderer->height = height;
+        renderer->full = 1;
+    }
+
+    if (rows != renderer->screen_rows || columns != renderer->screen_columns) renderer->full = 1;
+    renderer->screen_rows = rows;
+    renderer->screen_columns = columns;
+    if (header_lines + 1 != renderer->top) renderer->full = 1;
+    renderer->top = header_lines + 1;
+
+    int result;
+    renderer->length = 0;
+    if (renderer->full)
+    {
+        size_t header_length = strlen(header);
+        result = reserve(renderer, 7 + header_length);
+        if (result == 0)
+        {
+            append(renderer, "\033[H\033[2J", 7);
+            append(renderer, header, header_length);
+            result = build_map(renderer, map, NULL, -1, renderer->glyphs);
+        }
+    }
+    else
+        result = build_changes(renderer, header, header_lines, map);
+    if (result != 0)
+    {
+        renderer->length = 0;
+        renderer->full = 1; // the saved glyphs may not match the screen any more
+        return -1;
+    }
+    flush_frame(renderer);
+    renderer->printed_lines = 0;
+    renderer->printed_column = 0;
+
+    // A map that doesn't fit on the screen scrolls it, so the next frame can't draw over this one
+    int fits = rows == 0 || (renderer->top + height + 2 <= rows && 4 * (width + 1) + 1 <= columns);
+    renderer->full = !fits;
+    return 0;
+}
+
+int render_map (Renderer * renderer, const Board * map, const double * heatmap, long long highlight)
+{
+    if (map->layout != LAYOUT_ROWS) return -1;
+    renderer->length = 0;
+    if (build_map(renderer, map, heatmap, highlight, NULL) != 0)
+    {
+        renderer->length = 0;
+        return -1;
+    }
+    flush_frame(renderer);
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Terminal renderer for the map
+// Remembers what every tile looked like the last time the map was drawn, so after a move only
+// the tiles that changed are redrawn (each one is a cursor move plus one character) instead of
+// clearing the screen and printing the whole map again.  The whole screen is only redrawn for
+// the first frame, when the terminal is resized, after something else has been printed over
+// the map (see render_reset), or when what was printed below the map scrolled the screen (see
+// render_printed).
+//
+// Every frame is built in one buffer that is kept between frames and then written with a single
+// write: tiles are copied from a table of the characters for every possible tile value, and the
+// row and column numbers are only formatted again when the size of the map changes.
+#ifndef MS_RENDER_H
+#define MS_RENDER_H
+#include <stdio.h>
+#include "ms_engine.h"
+
+// What is on the screen
+typedef struct
+{
+    FILE * out;             // where the frames are written (normally stdout)
+    int width;              // size of the map on the screen (0 = nothing drawn yet)
+    int height;
+    int top;                // screen line the map's column numbers are on (starts at 1)
+    int screen_rows;        // size of the terminal when the last frame was drawn (0 = unknown)
+    int screen_columns;
+    char * glyphs;          // character shown for each tile (width * height)
+    int full;               // whether the next frame has to redraw the whole screen
+    int printed_lines;      // lines printed below the map since the last frame (see render_printed)
+    int printed_column;     // column the cursor was left on by them (starts at 0)
+
+    char cells[128][4];     // what a tile is drawn as (its character and 3 spaces) for every
+                            // tile value: count | mine << 4 | revealed << 5 | flag << 6
+    char * buffer;          // the frame being built
+    size_t length;
+    size_t capacity;
+    char * column_numbers;  // "    C1  C2  ...|\n" for a map numbers_width wide
+    size_t column_numbers_length;
+    int numbers_width;
+    char (*row_numbers)[12]; // "R1  ", "R2  ", ... for a map numbers_height high
+    int numbers_height;
+} Renderer;
+
+// render_init
+//   Renderer * renderer
+//   FILE * out: where to draw (should be a terminal that understands ANSI escape codes)
+// Sets up a renderer with nothing on the screen yet
+void render_init (Renderer * renderer, FILE * out);
+
+// render_free
+//   Renderer * renderer
+void render_free (Renderer * renderer);
+
+// render_reset
+//   Renderer * renderer
+// Forgets what's on the screen, so the next frame is drawn in full (call this after clearing the
+// screen or printing enough to scroll it)
+void render_reset (Renderer * renderer);
+
+// render_printed
+//   Renderer * renderer
+//   const char * text: what was printed (or typed, since the terminal echoes it) below the map
+// Keeps count of the lines below the last frame, including long lines that the terminal wraps,
+// so the next frame is drawn in full if they scrolled the map up the screen.  Everything printed
+// between frames has to be passed to this (or be followed by render_reset).
+void render_printed (Renderer * renderer, const char * text);
+
+// render_frame -> int
+//   Renderer * renderer
+//   const char * header: lines printed above the map (every line ending in '\n')
+//   const Board * map
+// Draws the header and the map in the same layout as draw_map in Minesweeper.c, then clears the
+// rest of the screen and leaves the cursor on the line below the map.  Only the tiles that have
+// changed since the last frame are written, unless the whole screen has to be redrawn.
+// Returns 0, or -1 if it runs out of memory or the map isn't LAYOUT_ROWS (in which case nothing
+// is written).
+int render_frame (Renderer * renderer, const char * header, const Board * map);
+
+// render_map -> int
+//   Renderer * renderer
+//   const Board * map
+//   const double * heatmap: chance of each tile being a mine, or NULL for the normal map
+//   long long highlight: index of a tile to show in reverse video (e.g. a hint), or -1
+// Prints the whole map where the cursor is, exactly like draw_map in Minesweeper.c, with a single
+// write.  Doesn't change what the renderer thinks is on the screen.
+// Returns 0, or -1 if it runs out of memory or the map isn't LAYOUT_ROWS (in which case nothing
+// is written).
+int render_map (Renderer * renderer, const Board * map, const double * heatmap, long long highlight);
+
+#endif
@@ -0,0 +1,207 @@
+// Saving and loading games (see ms_save.h)
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ms_save.h"
+
+#define SAVE_MAGIC "MSWEEPER"
+
+// Start of every save file (120 bytes, so the planes after it stay 8 byte aligned)
+typedef struct
+{
+    char magic[8];          // SAVE_MAGIC (without the '\0')
+    uint32_t version;       // SAVE_VERSION
+    uint32_t header_size;   // sizeof(SaveHeader)
+    int32_t width;
+    int32_t height;
+    int64_t num_mines;
+    int64_t score;
+    int64_t free_positions;
+    int64_t elapsed;        // seconds the game had been going when it was saved
+    int32_t status;         // MsStatus
+    int32_t unused;
+    uint64_t seed;
+    uint64_t rng[4];        // state of the game's random numbers
+    uint64_t board_checksum; // checksum of everything after the header
+    uint64_t header_checksum; // checksum of the header, with this field set to 0
+} SaveHeader;
+
+// Sizes of the planes of a map in a save file
+static size_t plane_words (int width, int height)
+{
+    return ((size_t)width * height + 63) / 64;
+}
+static size_t counts_bytes (int width, int height)
+{
+    return ((size_t)width * height + 1) / 2;
+}
+
+// Add some bytes to a checksum (a word at a time, so even huge maps take a few milliseconds)
+// Start with checksum = 0.  Not meant to stop anyone on purpose, only to catch damaged files.
+static uint64_t checksum (uint64_t hash, const void * data, size_t length)
+{
+    const unsigned char * bytes = data;
+    while (length >= 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        hash = (hash ^ word) * 0x100000001B3ULL;
+        hash ^= hash >> 29;
+        bytes += 8;
+        length -= 8;
+    }
+    while (length > 0)
+    {
+        hash = (hash ^ *bytes ++) * 0x100000001B3ULL;
+        length --;
+    }
+    return hash;
+}
+
+static uint64_t header_checksum (const SaveHeader * header)
+{
+    SaveHeader copy = *header;
+    copy.header_checksum = 0;
+    return checksum(0, &copy, sizeof(copy));
+}
+
+SaveResult ms_save (const Game * game, const char * path)
+{
+    size_t words = plane_words(game->width, game->height);
+    size_t counts = counts_bytes(game->width, game->height);
+
+    SaveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SAVE_MAGIC, 8);
+    header.version = SAVE_VERSION;
+    header.header_size = sizeof(SaveHeader);
+    header.width = game->width;
+    header.height = game->height;
+    header.num_mines = game->num_mines;
+    header.score = game->score;
+    header.free_positions = game->free_positions;
+    header.elapsed = time(NULL) - game->start_time;
+    header.status = game->status;
+    header.seed = game->seed;
+    memcpy(header.rng, game->rng.state, sizeof(header.rng));
+
+    uint64_t hash = checksum(0, game->map.mines, words * 8);
+    hash = checksum(hash, game->map.revealed, words * 8);
+    hash = checksum(hash, game->map.flags, words * 8);
+    header.board_checksum = checksum(hash, game->map.counts, counts);
+    header.header_checksum = header_checksum(&header);
+
+    // Write to a file next to it and rename that over the old save once it's all there
+    size_t length = strlen(path);
+    char * temporary = malloc(length + 5);
+    if (temporary == NULL) return SAVE_NO_MEMORY;
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+
+    FILE * file = fopen(temporary, "wb");
+    if (file == NULL)
+    {
+        free(temporary);
+        return SAVE_CANT_OPEN;
+    }
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1
+          && fwrite(game->map.mines, 8, words, file) == words
+          && fwrite(game->map.revealed, 8, words, file) == words
+          && fwrite(game->map.flags, 8, words, file) == words
+          && fwrite(game->map.counts, 1, counts, file) == counts;
+    ok = fclose(file) == 0 && ok;
+    ok = ok && rename(temporary, path) == 0;
+    if (!ok) remove(temporary);
+    free(temporary);
+    return ok ? SAVE_OK : SAVE_CANT_OPEN;
+}
+
+SaveResult ms_load (const char * path, int check_board, Game ** game)
+{
+    *game = NULL;
+    int file = open(path, O_RDONLY);
+    if (file < 0) return SAVE_CANT_OPEN;
+    struct stat info;
+    if (fstat(file, &info) != 0)
+    {
+        close(file);
+        return SAVE_CANT_OPEN;
+    }
+
+    // Check the header before mapping anything
+    SaveHeader header;
+    if (info.st_size < (off_t)sizeof(header) || read(file, &header, sizeof(header)) != sizeof(header))
+    {
+        close(file);
+        return SAVE_NOT_A_SAVE;
+    }
+    if (memcmp(header.magic, SAVE_MAGIC, 8) != 0 || header.version != SAVE_VERSION || header.header_size != sizeof(SaveHeader))
+    {
+        close(file);
+        return SAVE_NOT_A_SAVE;
+    }
+    if (header.header_checksum != header_checksum(&header) || header.width <= 0 || header.height <= 0
+        || header.status < MS_PLAYING || header.status > MS_LOST)
+    {
+        close(file);
+        return SAVE_CORRUPTED;
+    }
+    size_t words = plane_words(header.width, header.height);
+    size_t counts = counts_bytes(header.width, header.height);
+    size_t size = sizeof(header) + words * 8 * 3 + counts;
+    if ((uint64_t)info.st_size != size)
+    {
+        close(file);
+        return SAVE_CORRUPTED;
+    }
+
+    // Private mapping: the game can change its planes without changing the file
+    char * mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapping == MAP_FAILED) return errno == ENOMEM ? SAVE_NO_MEMORY : SAVE_CANT_OPEN;
+
+    Game * loaded = malloc(sizeof(Game));
+    if (loaded == NULL)
+    {
+        munmap(mapping, size);
+        return SAVE_NO_MEMORY;
+    }
+    loaded->width = header.width;
+    loaded->height = header.height;
+    loaded->num_mines = header.num_mines;
+    loaded->score = header.score;
+    loaded->free_positions = header.free_positions;
+    loaded->start_time = time(NULL) - header.elapsed;
+    loaded->status = header.status;
+    loaded->seed = header.seed;
+    memcpy(loaded->rng.state, header.rng, sizeof(header.rng));
+    loaded->mapping = mapping;
+    loaded->mapping_size = size;
+    loaded->on_move = NULL;
+    loaded->on_move_data = NULL;
+    loaded->history = NULL;
+
+    Board * map = &loaded->map;
+    map->width = header.width;
+    map->height = header.height;
+    map->layout = LAYOUT_ROWS;
+    map->frontier = NULL;
+    map->mines = (uint64_t *)(mapping + sizeof(header));
+    map->revealed = map->mines + words;
+    map->flags = map->revealed + words;
+    map->counts = (uint8_t *)(map->flags + words);
+
+    if (check_board && checksum(0, mapping + sizeof(header), size - sizeof(header)) != header.board_checksum)
+    {
+        ms_free(loaded);
+        return SAVE_CORRUPTED;
+    }
+
+    *game = loaded;
+    return SAVE_OK;
+}
@@ -0,0 +1,45 @@
+// Saving and loading games
+// A save file is a fixed header followed by the map's planes exactly as they are in memory, so
+// loading maps the file (copy on write) instead of reading it: the planes are paged in as the
+// game touches them, and resuming a 10000 x 10000 map takes about as long as a small one.
+//
+// Layout (all numbers little endian, as written by the machine that saved it):
+//      header      see SaveHeader in ms_save.c (magic, version, settings, score, time, checksums)
+//      mines       (width * height + 63) / 64 words
+//      revealed    same
+//      flags       same
+//      counts      (width * height + 1) / 2 bytes
+#ifndef MS_SAVE_H
+#define MS_SAVE_H
+#include "ms_engine.h"
+
+// Version written into new save files (files with any other version are refused)
+#define SAVE_VERSION 1
+
+// Result of saving or loading
+typedef enum
+{
+    SAVE_OK = 0,
+    SAVE_CANT_OPEN,         // the file couldn't be opened, read or written (see errno)
+    SAVE_NOT_A_SAVE,        // the file isn't a save file, or is from another version
+    SAVE_CORRUPTED,         // the file has been cut short or changed since it was saved
+    SAVE_NO_MEMORY
+} SaveResult;
+
+// ms_save -> SaveResult
+//   const Game * game
+//   const char * path: file to save to (replaced if it already exists)
+// Saves the game, including its score, marks, elapsed time and random number generator, so it
+// can be carried on with ms_load.  The file is written next to the old one and then renamed over
+// it, so a crash never leaves a half written save (and a game loaded from the same file is safe).
+SaveResult ms_save (const Game * game, const char * path);
+
+// ms_load -> SaveResult
+//   const char * path: file saved by ms_save
+//   int check_board: whether to check the planes against their checksum too (reads the whole
+//                    file); the header is always checked
+//   Game ** game: set to the loaded game (free it with ms_free as usual)
+// Loads a saved game.  The clock carries on from the time that had passed when it was saved.
+SaveResult ms_load (const char * path, int check_board, Game ** game);
+
+#endif
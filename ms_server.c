@@ -0,0 +1,622 @@
+// Minesweeper server (see ms_server.h)
+//
+// Every loop has its own epoll instance, and they all wait on the one listening socket
+// (EPOLLEXCLUSIVE wakes only one of them per new connection).  A connection then stays with the
+// loop that accepted it, so its buffers are never shared between threads.  Games are split into
+// one shard per loop: game n lives in shard (n - 1) % threads, and a loop makes new games in its
+// own shard.  Each shard has a lock, which is only ever contended when a connection plays a game
+// that another loop made.
+#define _GNU_SOURCE // accept4
+#include <errno.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "ms_engine.h"
+#include "ms_server.h"
+
+// Most bytes of replies a connection can have waiting before its requests stop being read
+// (a client that sends requests without reading the replies can't make the server run out of
+// memory)
+#define SERVER_MAX_PENDING (1 << 20)
+
+// The games of one loop
+typedef struct
+{
+    pthread_mutex_t lock;
+    Game ** games;          // game in each slot (NULL = free slot)
+    size_t capacity;        // number of slots
+    size_t * free_slots;    // stack of the free slots below used
+    size_t num_free;
+    size_t used;            // slots at or above this have never been used
+} Shard;
+
+typedef struct
+{
+    int listener;
+    int num_shards;
+    Shard shards[SERVER_MAX_THREADS];
+} Server;
+
+// One event loop (and its thread)
+typedef struct
+{
+    Server * server;
+    int shard;              // shard it makes new games in
+    int epoll_fd;
+    Rng rng;                // seeds for new games that weren't given one
+    MsMove moves[SERVER_MAX_LINE / 6]; // moves of a moves request (each takes at least 6 characters)
+    MsChanges changes;      // what they changed
+} Loop;
+
+// A client
+typedef struct
+{
+    int fd;
+    char in[SERVER_MAX_LINE]; // start of the next request
+    size_t in_length;
+    char * out;             // replies that haven't been sent yet
+    size_t out_sent;        // how much of out has been sent
+    size_t out_length;
+    size_t out_capacity;
+    uint32_t events;        // what epoll is waiting for on the socket
+} Connection;
+
+
+/* Addresses */
+
+// Fill in the socket address for an address (see server_listen)
+// Returns 0, or -1 if it isn't a valid address
+static int make_address (const char * address, struct sockaddr_storage * storage, socklen_t * length)
+{
+    memset(storage, 0, sizeof(*storage));
+    if (strchr(address, '/') != NULL)
+    {
+        struct sockaddr_un * unix_address = (struct sockaddr_un *)storage;
+        if (strlen(address) >= sizeof(unix_address->sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        unix_address->sun_family = AF_UNIX;
+        strcpy(unix_address->sun_path, address);
+        *length = sizeof(struct sockaddr_un);
+        return 0;
+    }
+
+    char host[256] = "127.0.0.1";
+    const char * port = strrchr(address, ':');
+    if (port != NULL)
+    {
+        size_t host_length = port - address;
+        if (host_length >= sizeof(host))
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        memcpy(host, address, host_length);
+        host[host_length] = '\0';
+        port ++;
+    }
+    else
+        port = address;
+
+    struct addrinfo hints;
+    struct addrinfo * found;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &found) != 0)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(storage, found->ai_addr, found->ai_addrlen);
+    *length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return 0;
+}
+
+// Send small replies and requests straight away instead of waiting to fill a packet
+// (does nothing on a Unix socket)
+static void no_delay (int fd)
+{
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+int server_listen (const char * address)
+{
+    struct sockaddr_storage storage;
+    socklen_t length;
+    if (make_address(address, &storage, &length) != 0) return -1;
+
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (storage.ss_family == AF_UNIX)
+        unlink(address);
+    else
+    {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    }
+    if (bind(fd, (struct sockaddr *)&storage, length) != 0 || listen(fd, SOMAXCONN) != 0)
+    {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    return fd;
+}
+
+int server_connect (const char * address)
+{
+    struct sockaddr_storage storage;
+    socklen_t length;
+    if (make_address(address, &storage, &length) != 0) return -1;
+
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *)&storage, length) != 0)
+    {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+    no_delay(fd);
+    return fd;
+}
+
+
+/* Games */
+
+// Put a game in a free slot of a shard
+// Returns the game's number, or 0 if it runs out of memory
+static long long add_game (Server * server, int shard_number, Game * game)
+{
+    Shard * shard = &server->shards[shard_number];
+    long long number = 0;
+    pthread_mutex_lock(&shard->lock);
+
+    size_t slot = shard->used;
+    if (shard->num_free > 0)
+        slot = shard->free_slots[-- shard->num_free];
+    else if (shard->used == shard->capacity)
+    {
+        size_t capacity = shard->capacity > 0 ? shard->capacity * 2 : 64;
+        Game ** games = realloc(shard->games, sizeof(Game *) * capacity);
+        if (games != NULL) shard->games = games;
+        size_t * free_slots = realloc(shard->free_slots, sizeof(size_t) * capacity);
+        if (free_slots != NULL) shard->free_slots = free_slots;
+        if (games == NULL || free_slots == NULL) slot = capacity; // out of memory
+        else shard->capacity = capacity;
+    }
+
+    if (slot < shard->capacity)
+    {
+        if (slot == shard->used) shard->used ++;
+        shard->games[slot] = game;
+        number = (long long)slot * server->num_shards + shard_number + 1;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    return number;
+}
+
+// Lock the shard a game is in and find the game
+// Returns the game with its shard locked (unlock with unlock_game), or NULL if there's no such
+// game (the shard isn't left locked)
+static Game * lock_game (Server * server, long long number, Shard ** shard, size_t * slot)
+{
+    if (number < 1) return NULL;
+    *shard = &server->shards[(number - 1) % server->num_shards];
+    *slot = (number - 1) / server->num_shards;
+
+    pthread_mutex_lock(&(*shard)->lock);
+    if (*slot < (*shard)->used && (*shard)->games[*slot] != NULL) return (*shard)->games[*slot];
+    pthread_mutex_unlock(&(*shard)->lock);
+    return NULL;
+}
+
+static void unlock_game (Shard * shard)
+{
+    pthread_mutex_unlock(&shard->lock);
+}
+
+
+/* Protocol */
+
+static const char * result_name (MsResult result)
+{
+    switch (result)
+    {
+        case MS_OK: return "ok";
+        case MS_NO_CHANGE: return "nochange";
+        case MS_MINE: return "mine";
+        case MS_OUT_OF_RANGE: return "outofrange";
+        case MS_GAME_OVER: return "gameover";
+        default: return "nomemory";
+    }
+}
+
+static const char * status_name (MsStatus status)
+{
+    return status == MS_WON ? "won" : status == MS_LOST ? "lost" : "playing";
+}
+
+// Make room for at least `extra` more bytes of replies
+// Returns 0, or -1 if it runs out of memory
+static int reserve_reply (Connection * connection, size_t extra)
+{
+    if (connection->out_length + extra <= connection->out_capacity) return 0;
+
+    size_t capacity = connection->out_capacity > 0 ? connection->out_capacity : 4096;
+    while (capacity < connection->out_length + extra) capacity *= 2;
+    char * bigger = realloc(connection->out, capacity);
+    if (bigger == NULL) return -1;
+    connection->out = bigger;
+    connection->out_capacity = capacity;
+    return 0;
+}
+
+// Add a reply (printf style)
+// Returns 0, or -1 if it runs out of memory
+static int reply (Connection * connection, const char * format, ...)
+{
+    if (reserve_reply(connection, SERVER_MAX_LINE) != 0) return -1;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(connection->out + connection->out_length, SERVER_MAX_LINE, format, args);
+    va_end(args);
+    connection->out_length += length < SERVER_MAX_LINE ? length : SERVER_MAX_LINE - 1;
+    return 0;
+}
+
+// Character a tile is drawn as in replies
+static char tile_glyph (const Game * game, size_t index)
+{
+    const Board * map = &game->map;
+    if (test_bit(map->flags, index))
+        return '?';
+    if (test_bit(map->mines, index) && game->status == MS_LOST)
+        return '#';
+    if (!test_bit(map->revealed, index))
+        return '.';
+    return '0' + tile_count(map, index);
+}
+
+// Add the reply to a state request
+// Returns 0, or -1 if it runs out of memory
+static int reply_state (Connection * connection, const Game * game)
+{
+    size_t tiles = (size_t)game->width * game->height;
+    if (reserve_reply(connection, SERVER_MAX_LINE + tiles) != 0) return -1;
+    connection->out_length += sprintf(connection->out + connection->out_length, "OK %s %lld %lld %d %d ",
+                                      status_name(game->status), game->score, game->free_positions, game->width, game->height);
+
+    char * out = connection->out + connection->out_length;
+    for (size_t index = 0; index < tiles; index ++)
+        out[index] = tile_glyph(game, index);
+    out[tiles] = '\n';
+    connection->out_length += tiles + 1;
+    return 0;
+}
+
+// Add the reply to a moves request
+// Returns 0, or -1 if it runs out of memory
+static int reply_changes (Connection * connection, const Game * game, MsResult result, const MsChanges * changes)
+{
+    if (reserve_reply(connection, SERVER_MAX_LINE + changes->count * 26) != 0) return -1; // "row,column,glyph " each
+    char * out = connection->out + connection->out_length;
+    out += sprintf(out, "OK %s %s %lld %lld %zu %zu", result_name(result), status_name(game->status),
+                   game->score, game->free_positions, changes->moves, changes->count);
+    for (size_t i = 0; i < changes->count; i ++)
+    {
+        size_t index = changes->tiles[i];
+        out += sprintf(out, " %zu,%zu,%c", index / game->width, index % game->width, tile_glyph(game, index));
+    }
+    *out ++ = '\n';
+    connection->out_length = out - connection->out;
+    return 0;
+}
+
+// Read the moves of a moves request ("r ROW COLUMN m ROW COLUMN c ROW COLUMN ...")
+// Returns the number of moves, or -1 if they aren't written properly
+static int parse_moves (const char * text, MsMove * moves, int max_moves)
+{
+    int count = 0;
+    char type[2];
+    long long row, column;
+    int used;
+    while (sscanf(text, " %1s %lld %lld%n", type, &row, &column, &used) == 3)
+    {
+        if (count == max_moves || (type[0] != 'r' && type[0] != 'm' && type[0] != 'c')) return -1;
+        moves[count].type = type[0] == 'r' ? MS_MOVE_REVEAL : type[0] == 'm' ? MS_MOVE_MARK : MS_MOVE_CHORD;
+        moves[count].row = row >= 0 && row <= SERVER_MAX_TILES ? row : -1; // anything bigger is off the map anyway
+        moves[count].column = column >= 0 && column <= SERVER_MAX_TILES ? column : -1;
+        count ++;
+        text += used;
+    }
+    while (*text == ' ') text ++;
+    return *text == '\0' ? count : -1;
+}
+
+// Answer one request
+// Returns 0, or -1 if it runs out of memory
+static int answer (Loop * loop, Connection * connection, const char * line)
+{
+    Server * server = loop->server;
+    char command[16];
+    long long numbers[3];
+    int count = sscanf(line, "%15s %lld %lld %lld", command, &numbers[0], &numbers[1], &numbers[2]) - 1;
+    if (count < 0) return reply(connection, "ERR empty request\n");
+
+    if (strcmp(command, "new") == 0)
+    {
+        long long width = numbers[0], height = numbers[1], num_mines = numbers[2];
+        unsigned long long seed;
+        if (count < 3) return reply(connection, "ERR usage: new WIDTH HEIGHT MINES [SEED]\n");
+        if (width < 1 || height < 1 || width > SERVER_MAX_TILES || height > SERVER_MAX_TILES || width * height > SERVER_MAX_TILES
+            || num_mines < 0 || num_mines > width * height)
+            return reply(connection, "ERR the map must have 1 to %d tiles and at most one mine per tile\n", SERVER_MAX_TILES);
+        if (sscanf(line, "%*s %*d %*d %*d %llu", &seed) != 1) seed = rng_next(&loop->rng);
+
+        // Making the map is the slow part, so it's done before the shard is locked
+        Game * game = ms_new(width, height, num_mines, seed);
+        long long number = game == NULL ? 0 : add_game(server, loop->shard, game);
+        if (number == 0)
+        {
+            ms_free(game);
+            return reply(connection, "ERR not enough memory\n");
+        }
+        return reply(connection, "OK %lld %llu\n", number, seed);
+    }
+
+    int moves = strcmp(command, "moves") == 0;
+    int wanted = strcmp(command, "reveal") == 0 || strcmp(command, "mark") == 0 || strcmp(command, "chord") == 0 ? 3
+               : strcmp(command, "state") == 0 || strcmp(command, "free") == 0 || moves ? 1 : -1;
+    if (wanted < 0) return reply(connection, "ERR unknown request (new, reveal, mark, chord, moves, state or free)\n");
+    if (count < wanted) return reply(connection, wanted == 3 ? "ERR usage: %s GAME ROW COLUMN\n" : "ERR usage: %s GAME\n", command);
+
+    int num_moves = 0;
+    if (moves)
+    {
+        int used;
+        sscanf(line, "%*s %*d%n", &used);
+        num_moves = parse_moves(line + used, loop->moves, sizeof(loop->moves) / sizeof(loop->moves[0]));
+        if (num_moves < 0) return reply(connection, "ERR usage: moves GAME r|m|c ROW COLUMN [r|m|c ROW COLUMN ...]\n");
+    }
+
+    Shard * shard;
+    size_t slot;
+    Game * game = lock_game(server, numbers[0], &shard, &slot);
+    if (game == NULL) return reply(connection, "ERR no game %lld\n", numbers[0]);
+
+    int result;
+    if (strcmp(command, "state") == 0)
+        result = reply_state(connection, game);
+    else if (strcmp(command, "free") == 0)
+    {
+        ms_free(game);
+        shard->games[slot] = NULL;
+        shard->free_slots[shard->num_free ++] = slot;
+        result = reply(connection, "OK\n");
+    }
+    else if (moves)
+    {
+        MsResult played = ms_apply(game, loop->moves, num_moves, &loop->changes);
+        result = reply_changes(connection, game, played, &loop->changes);
+    }
+    else
+    {
+        // Rows and columns that don't fit in an int are just as out of range
+        long long row = numbers[1], column = numbers[2];
+        MsResult move = MS_OUT_OF_RANGE;
+        if (row >= 0 && column >= 0 && row < game->height && column < game->width)
+            move = command[0] == 'r' ? ms_reveal(game, row, column)
+                 : command[0] == 'm' ? ms_mark(game, row, column) : ms_chord(game, row, column);
+        result = reply(connection, "OK %s %s %lld %lld\n", result_name(move), status_name(game->status), game->score, game->free_positions);
+    }
+    unlock_game(shard);
+    return result;
+}
+
+
+/* Event Loop */
+
+// Tell epoll what to wait for on a connection: requests, as long as not too many replies are
+// waiting, and room to write, if any are
+// Returns 0, or -1 if epoll fails
+static int update_events (Loop * loop, Connection * connection)
+{
+    size_t pending = connection->out_length - connection->out_sent;
+    uint32_t events = (pending < SERVER_MAX_PENDING ? EPOLLIN : 0) | (pending > 0 ? EPOLLOUT : 0);
+    if (events == connection->events) return 0;
+
+    struct epoll_event event;
+    event.events = events;
+    event.data.ptr = connection;
+    connection->events = events;
+    return epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, connection->fd, &event);
+}
+
+// Send as many of the waiting replies as the socket takes
+// Returns 0, or -1 if the connection is broken
+static int send_replies (Connection * connection)
+{
+    while (connection->out_sent < connection->out_length)
+    {
+        ssize_t written = write(connection->fd, connection->out + connection->out_sent, connection->out_length - connection->out_sent);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && errno == EAGAIN) return 0;
+        if (written <= 0) return -1;
+        connection->out_sent += written;
+    }
+    connection->out_sent = 0;
+    connection->out_length = 0;
+    return 0;
+}
+
+// Read and answer requests until there are none left (or too many replies are waiting)
+// Returns 0, or -1 if the connection should be closed
+static int read_requests (Loop * loop, Connection * connection)
+{
+    while (connection->out_length - connection->out_sent < SERVER_MAX_PENDING)
+    {
+        ssize_t got = read(connection->fd, connection->in + connection->in_length, SERVER_MAX_LINE - connection->in_length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0 && errno == EAGAIN) return 0;
+        if (got <= 0) return -1; // closed by the client (or broken)
+        connection->in_length += got;
+
+        // Answer every whole line, and keep the start of the next one
+        char * start = connection->in;
+        char * end;
+        while ((end = memchr(start, '\n', connection->in + connection->in_length - start)) != NULL)
+        {
+            *end = '\0';
+            if (end > start && end[-1] == '\r') end[-1] = '\0';
+            if (answer(loop, connection, start) != 0) return -1;
+            start = end + 1;
+        }
+        connection->in_length -= start - connection->in;
+        memmove(connection->in, start, connection->in_length);
+        if (connection->in_length == SERVER_MAX_LINE) return -1; // request too long
+    }
+    return 0;
+}
+
+static void close_connection (Connection * connection)
+{
+    close(connection->fd); // also takes it out of the epoll set
+    free(connection->out);
+    free(connection);
+}
+
+// Accept every connection that's waiting
+static void accept_connections (Loop * loop)
+{
+    for (;;)
+    {
+        int fd = accept4(loop->server->listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0 && errno == EINTR) continue;
+        if (fd < 0) return; // none left (or another loop took it)
+        no_delay(fd);
+
+        Connection * connection = calloc(1, sizeof(Connection));
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = connection;
+        if (connection == NULL || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            free(connection);
+            continue;
+        }
+        connection->fd = fd;
+        connection->events = EPOLLIN;
+    }
+}
+
+static void * run_loop (void * data)
+{
+    Loop * loop = data;
+    struct epoll_event events[64];
+    for (;;)
+    {
+        int count = epoll_wait(loop->epoll_fd, events, 64, -1);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) break;
+
+        for (int i = 0; i < count; i ++)
+        {
+            Connection * connection = events[i].data.ptr;
+            if (connection == NULL) // the listening socket
+            {
+                accept_connections(loop);
+                continue;
+            }
+            if (read_requests(loop, connection) != 0 || send_replies(connection) != 0 || update_events(loop, connection) != 0)
+                close_connection(connection);
+        }
+    }
+    return NULL;
+}
+
+int server_run (int listener, int threads)
+{
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+    if (threads > SERVER_MAX_THREADS) threads = SERVER_MAX_THREADS;
+
+    Server * server = calloc(1, sizeof(Server));
+    Loop * loops = calloc(threads, sizeof(Loop));
+    pthread_t * workers = calloc(threads, sizeof(pthread_t));
+    int made = 0;
+    if (server != NULL && loops != NULL && workers != NULL)
+    {
+        server->listener = listener;
+        server->num_shards = threads;
+        uint64_t seed = rng_time_seed();
+        for (; made < threads; made ++)
+        {
+            Loop * loop = &loops[made];
+            loop->server = server;
+            loop->shard = made;
+            loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+            rng_seed(&loop->rng, rng_splitmix64(&seed));
+            pthread_mutex_init(&server->shards[made].lock, NULL);
+
+            struct epoll_event event;
+            event.events = EPOLLIN | (threads > 1 ? EPOLLEXCLUSIVE : 0);
+            event.data.ptr = NULL;
+            if (loop->epoll_fd < 0 || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, listener, &event) != 0)
+            {
+                if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+                pthread_mutex_destroy(&server->shards[made].lock);
+                break;
+            }
+        }
+    }
+
+    // This thread runs the first loop, so one fewer thread is started
+    int started = 1;
+    if (made == threads)
+    {
+        while (started < threads && pthread_create(&workers[started], NULL, run_loop, &loops[started]) == 0)
+            started ++;
+        if (started == threads) run_loop(&loops[0]); // only returns if epoll fails
+    }
+    for (int i = 1; i < started; i ++)
+    {
+        pthread_cancel(workers[i]);
+        pthread_join(workers[i], NULL);
+    }
+
+    for (int i = 0; i < made; i ++)
+    {
+        Shard * shard = &server->shards[i];
+        for (size_t slot = 0; slot < shard->used; slot ++) ms_free(shard->games[slot]);
+        free(shard->games);
+        free(shard->free_slots);
+        pthread_mutex_destroy(&shard->lock);
+        close(loops[i].epoll_fd);
+        ms_changes_free(&loops[i].changes);
+    }
+    free(workers);
+    free(loops);
+    free(server);
+    return -1;
+}
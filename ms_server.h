@@ -0,0 +1,51 @@
+// Minesweeper server
+// Holds any number of games in one process and serves them over a Unix or TCP socket with a
+// line protocol.  Each thread runs one epoll loop over its own connections (there is no thread
+// or process per game or per player), and owns a shard of the games.
+//
+// Every request is one line and gets one line back, "OK ..." or "ERR <reason>".  Rows and
+// columns start at 0, like the engine.
+//
+//      new WIDTH HEIGHT MINES [SEED]   -> OK <game> <seed>
+//      reveal GAME ROW COLUMN          -> OK <result> <status> <score> <remaining tiles>
+//      mark GAME ROW COLUMN            -> OK <result> <status> <score> <remaining tiles>
+//      chord GAME ROW COLUMN           -> OK <result> <status> <score> <remaining tiles>
+//      moves GAME r|m|c ROW COLUMN ... -> OK <result> <status> <score> <remaining tiles> <moves played>
+//                                            <tiles changed> ROW,COLUMN,TILE ...
+//      state GAME                      -> OK <status> <score> <remaining tiles> <width> <height> <tiles>
+//      free GAME                       -> OK
+//
+// moves plays a whole batch of reveals (r), marks (m) and chords (c) with ms_apply, and lists
+// every tile the batch changed, so a client only waits for one reply per batch.
+// <result> is ok, nochange, mine, outofrange or gameover (see MsResult), <status> is playing,
+// won or lost, and <tiles> is every tile row by row, drawn like the map (. hidden, ? marked,
+// 0-8 open, # a mine once the game is lost).  Games are numbered from 1; the number of a game
+// that has been freed is given to the next new game, like a file descriptor.
+#ifndef MS_SERVER_H
+#define MS_SERVER_H
+
+#define SERVER_MAX_LINE 4096        // longest request (longer ones close the connection)
+#define SERVER_MAX_TILES (1 << 24)  // biggest map a client can ask for
+#define SERVER_MAX_THREADS 64
+
+// server_listen -> int
+//   const char * address: a path with a '/' in it for a Unix socket (e.g. ./ms.sock), or
+//                         [HOST:]PORT for TCP (HOST defaults to 127.0.0.1)
+// Opens a listening socket at the address (an old Unix socket file is replaced)
+// Returns the socket, or -1 if it can't (errno says why)
+int server_listen (const char * address);
+
+// server_connect -> int
+//   const char * address: same as server_listen
+// Returns a socket connected to the server at the address, or -1 if it can't
+int server_connect (const char * address);
+
+// server_run -> int
+//   int listener: socket returned by server_listen
+//   int threads: number of event loops (0 = one per core, at most SERVER_MAX_THREADS)
+// Accepts connections and answers their requests until the process is killed.  Each
+// connection is served by whichever loop accepts it, and can play games from any shard.
+// Returns -1 if the loops can't be started
+int server_run (int listener, int threads);
+
+#endif
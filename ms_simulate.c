@@ -0,0 +1,282 @@
+// Monte Carlo win rates (see ms_simulate.h)
+//
+// The games are numbered and split into batches of SIMULATION_BATCH.  Every thread starts with
+// an equal, contiguous range of batches and plays them from the front of its range.  A thread
+// whose range is empty steals the back half of the first other range that isn't, so the threads
+// keep busy until the very end even though some games take far longer than others (a big
+// opening and a long solve, against a mine on the second move).  Ranges are only locked to take
+// a batch, which happens once every SIMULATION_BATCH games.
+//
+// Nothing random is shared between threads: game n is made from the n-th value of a splitmix64
+// stream of the seed, and its random guesses come from the game's own Rng.  Which thread plays
+// a game makes no difference to how it goes, so the result only depends on the seed.
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "ms_simulate.h"
+#include "ms_solver.h"
+
+typedef struct SimulationWork SimulationWork;
+
+// One thread's batches and what it has found so far
+typedef struct
+{
+    pthread_mutex_t lock;
+    long long next;         // next batch to play
+    long long end;          // batches from next up to (not including) end are still to be played
+    long long games;
+    long long wins;
+    long long guesses;
+    int out_of_memory;
+    int index;
+    SimulationWork * work;
+} SimulationThread;
+
+// Settings shared by every thread
+struct SimulationWork
+{
+    int width;
+    int height;
+    long long num_mines;
+    Policy policy;
+    long long games;
+    uint64_t seed;
+    int num_threads;
+    SimulationThread * threads;
+};
+
+// Seed of game n
+static uint64_t game_seed (uint64_t seed, long long game)
+{
+    uint64_t x = seed + (uint64_t)game * 0x9E3779B97F4A7C15ULL; // n steps along the stream
+    return rng_splitmix64(&x);
+}
+
+// A random hidden tile that isn't marked (there must be one)
+static size_t random_hidden (Game * game)
+{
+    Board * map = &game->map;
+    size_t tiles = (size_t)game->width * game->height;
+
+    // Usually plenty of the map is still hidden, so a few tries find one
+    for (int i = 0; i < 64; i ++)
+    {
+        size_t index = rng_below(&game->rng, tiles);
+        if (!test_bit(map->revealed, index) && !test_bit(map->flags, index)) return index;
+    }
+
+    size_t hidden = 0;
+    for (size_t index = 0; index < tiles; index ++)
+        hidden += !test_bit(map->revealed, index) && !test_bit(map->flags, index);
+    size_t pick = rng_below(&game->rng, hidden);
+    for (size_t index = 0; ; index ++)
+        if (!test_bit(map->revealed, index) && !test_bit(map->flags, index) && pick -- == 0)
+            return index;
+}
+
+// The hidden tile least likely to be a mine (the first one if there's a tie), or a random one
+// if the chances can't be worked out
+// probability: room for one chance per tile
+static size_t safest_hidden (Game * game, double * probability)
+{
+    Board * map = &game->map;
+    if (mine_probabilities(map, game->num_mines, probability) != 0) return random_hidden(game);
+
+    size_t tiles = (size_t)game->width * game->height;
+    size_t best = tiles;
+    for (size_t index = 0; index < tiles; index ++)
+    {
+        if (test_bit(map->revealed, index) || test_bit(map->flags, index)) continue;
+        if (best == tiles || probability[index] < probability[best]) best = index;
+    }
+    return best;
+}
+
+// Play game n to the end
+// Returns 1 if it was won, 0 if it was lost, or -1 if it ran out of memory
+static int play_game (SimulationWork * work, long long n, double * probability, long long * guesses)
+{
+    int width = work->width;
+    Game * game = ms_new_at(width, work->height, work->num_mines, game_seed(work->seed, n), work->height / 2, width / 2);
+    if (game == NULL) return -1;
+
+    int result = 0;
+    while (ms_status(game) == MS_PLAYING)
+    {
+        if (work->policy != POLICY_RANDOM)
+        {
+            SolveResult solved = ms_solve(game);
+            if (solved == SOLVE_NO_MEMORY) result = -1;
+            if (solved != SOLVE_GUESS) break;
+        }
+
+        size_t index = work->policy == POLICY_PROBABILITY ? safest_hidden(game, probability) : random_hidden(game);
+        (*guesses) ++;
+        if (ms_reveal(game, index / width, index % width) == MS_NO_MEMORY)
+        {
+            result = -1;
+            break;
+        }
+    }
+    if (result == 0) result = ms_status(game) == MS_WON;
+    ms_free(game);
+    return result;
+}
+
+// Take the next batch of a thread's own range
+// Returns the batch, or -1 if the range is empty
+static long long take_batch (SimulationThread * thread)
+{
+    long long batch = -1;
+    pthread_mutex_lock(&thread->lock);
+    if (thread->next < thread->end) batch = thread->next ++;
+    pthread_mutex_unlock(&thread->lock);
+    return batch;
+}
+
+// Move the back half of another thread's batches to this thread's (empty) range
+// Returns 0, or -1 if every other thread has run out too
+static int steal_batches (SimulationThread * thread)
+{
+    SimulationWork * work = thread->work;
+    for (int i = 1; i < work->num_threads; i ++)
+    {
+        SimulationThread * victim = &work->threads[(thread->index + i) % work->num_threads];
+        pthread_mutex_lock(&victim->lock);
+        long long left = victim->end - victim->next;
+        long long stolen = (left + 1) / 2;
+        victim->end -= stolen;
+        long long from = victim->end;
+        pthread_mutex_unlock(&victim->lock);
+        if (stolen == 0) continue;
+
+        pthread_mutex_lock(&thread->lock);
+        thread->next = from;
+        thread->end = from + stolen;
+        pthread_mutex_unlock(&thread->lock);
+        return 0;
+    }
+    return -1;
+}
+
+static void * simulation_worker (void * data)
+{
+    SimulationThread * thread = data;
+    SimulationWork * work = thread->work;
+    double * probability = NULL;
+    if (work->policy == POLICY_PROBABILITY)
+    {
+        probability = malloc(sizeof(double) * work->width * work->height);
+        if (probability == NULL)
+        {
+            thread->out_of_memory = 1;
+            return NULL;
+        }
+    }
+
+    while (!thread->out_of_memory)
+    {
+        long long batch = take_batch(thread);
+        if (batch < 0)
+        {
+            if (steal_batches(thread) != 0) break;
+            continue;
+        }
+
+        long long first = batch * SIMULATION_BATCH;
+        long long last = first + SIMULATION_BATCH < work->games ? first + SIMULATION_BATCH : work->games;
+        for (long long n = first; n < last; n ++)
+        {
+            int result = play_game(work, n, probability, &thread->guesses);
+            if (result < 0)
+            {
+                thread->out_of_memory = 1;
+                break;
+            }
+            thread->wins += result;
+            thread->games ++;
+        }
+    }
+    free(probability);
+    return NULL;
+}
+
+int simulate (int width, int height, long long num_mines, Policy policy, long long games, uint64_t seed, int threads, Simulation * result)
+{
+    if (width <= 0 || height <= 0 || num_mines < 0 || num_mines >= (long long)width * height || games <= 0) return -1;
+    if (threads <= 0)
+    {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+    long long batches = (games + SIMULATION_BATCH - 1) / SIMULATION_BATCH;
+    if (threads > batches) threads = batches;
+
+    SimulationWork work;
+    work.width = width;
+    work.height = height;
+    work.num_mines = num_mines;
+    work.policy = policy;
+    work.games = games;
+    work.seed = seed;
+    work.num_threads = threads;
+    work.threads = calloc(threads, sizeof(SimulationThread));
+    pthread_t * workers = malloc(sizeof(pthread_t) * threads);
+    if (work.threads == NULL || workers == NULL)
+    {
+        free(work.threads);
+        free(workers);
+        return -1;
+    }
+    for (int i = 0; i < threads; i ++)
+    {
+        SimulationThread * thread = &work.threads[i];
+        pthread_mutex_init(&thread->lock, NULL);
+        thread->next = batches * i / threads;
+        thread->end = batches * (i + 1) / threads;
+        thread->index = i;
+        thread->work = &work;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // This thread works too, so one fewer thread is started (any that can't be started leave
+    // their batches to be stolen)
+    int started = 1;
+    while (started < threads && pthread_create(&workers[started], NULL, simulation_worker, &work.threads[started]) == 0)
+        started ++;
+    simulation_worker(&work.threads[0]);
+    for (int i = 1; i < started; i ++) pthread_join(workers[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int out_of_memory = 0;
+    result->games = result->wins = result->guesses = 0;
+    for (int i = 0; i < threads; i ++)
+    {
+        result->games += work.threads[i].games;
+        result->wins += work.threads[i].wins;
+        result->guesses += work.threads[i].guesses;
+        out_of_memory |= work.threads[i].out_of_memory;
+        pthread_mutex_destroy(&work.threads[i].lock);
+    }
+    free(work.threads);
+    free(workers);
+    if (out_of_memory) return -1;
+
+    // Wilson score interval, which unlike p +- z * sqrt(p (1 - p) / n) stays between 0 and 1 and
+    // still makes sense when (almost) every game is won or lost
+    double n = result->games;
+    double p = result->wins / n;
+    double z = 1.96;
+    double centre = (p + z * z / (2 * n)) / (1 + z * z / n);
+    double spread = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+    result->win_rate = p;
+    result->low = centre - spread;
+    result->high = centre + spread;
+    result->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    result->threads = threads;
+    return 0;
+}
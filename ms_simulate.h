@@ -0,0 +1,46 @@
+// Monte Carlo win rates
+// Plays a large number of games with one of a few simple players (policies) on every core and
+// reports how many of them were won, to see how the chance of winning changes with the size of
+// the map and the number of mines.
+#ifndef MS_SIMULATE_H
+#define MS_SIMULATE_H
+#include "ms_engine.h"
+
+// How the simulated player picks its moves
+typedef enum
+{
+    POLICY_SOLVER = 0,      // every move the solver can prove, and a random hidden tile when stuck
+    POLICY_PROBABILITY,     // every move the solver can prove, and the hidden tile least likely
+                            //   to be a mine when stuck (see mine_probabilities)
+    POLICY_RANDOM           // a random hidden tile every move
+} Policy;
+
+// Games handed to a thread at a time.  A thread that runs out of batches steals half of the
+// batches another thread has left.
+#define SIMULATION_BATCH 64
+
+// What a simulation found out
+typedef struct
+{
+    long long games;        // games played
+    long long wins;         // how many of them were won
+    long long guesses;      // moves that weren't proven safe, over all the games
+    double win_rate;        // wins / games
+    double low, high;       // 95% confidence interval of the win rate (Wilson score interval)
+    double seconds;         // time it took
+    int threads;            // number of threads it used
+} Simulation;
+
+// simulate -> int
+//   int width, int height, long long num_mines: settings of every game
+//   Policy policy: how the games are played
+//   long long games: number of games to play
+//   uint64_t seed: game n's map and its random moves come from this seed and n alone
+//   int threads: number of threads to play on (0 = one per core)
+//   Simulation * result: output
+// Plays the games, each starting with an opening at the middle tile (like ms_new_no_guess).
+// The same seed always gives the same result, whatever the number of threads.
+// Returns 0, or -1 if the settings are invalid or it runs out of memory.
+int simulate (int width, int height, long long num_mines, Policy policy, long long games, uint64_t seed, int threads, Simulation * result);
+
+#endif
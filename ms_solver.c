@@ -0,0 +1,591 @@
+// Deterministic Minesweeper solver (see ms_solver.h)
+//
+// Every open number gives a constraint: its hidden, unmarked neighbours hold exactly
+// (count - marked neighbours) mines.  The hidden tiles of a constraint are kept as bits of a
+// 7x7 window around some centre tile, which is big enough to hold the neighbours of any two
+// numbers up to two tiles apart, so comparing two constraints is a couple of mask operations.
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ms_solver.h"
+
+// Side of the window the hidden tiles are kept in (see WINDOW_BIT)
+#define WINDOW 7
+#define WINDOW_BIT(row, column) (((row) + 3) * WINDOW + (column) + 3)
+
+// The hidden, unmarked neighbours of an open number and how many of them are mines
+typedef struct
+{
+    uint64_t hidden;    // bits of the 7x7 window (see WINDOW_BIT)
+    int need;           // number of mines among them
+} Constraint;
+
+// The bits of a plane for the tiles left of, at and right of (row, column) as bits 0-2, with
+// the bits for columns off the edge of the map set to 0
+static inline unsigned three_bits (const Board * map, const uint64_t * plane, int row, int column)
+{
+    size_t words = ((size_t)map->width * map->height + 63) / 64;
+    size_t index = tile_index(map, row, column);
+    int from_edge = column == 0; // no tile to the left: read from the tile itself
+    index -= !from_edge;
+
+    unsigned shift = index & 63;
+    uint64_t bits = plane[index >> 6] >> shift;
+    if (shift > 61 && (index >> 6) + 1 < words) bits |= plane[(index >> 6) + 1] << (64 - shift);
+    bits <<= from_edge;
+
+    unsigned valid = column + 1 < map->width ? 7 : 3;
+    return bits & valid & (from_edge ? 6 : 7);
+}
+
+// Work out the constraint of the tile at (row, column), with its hidden tiles placed in the
+// window centred on (centre_row, centre_column)
+// Returns 0 if the tile isn't an open number with hidden, unmarked neighbours
+static int get_constraint (const Board * map, int row, int column, int centre_row, int centre_column, Constraint * constraint)
+{
+    size_t index = tile_index(map, row, column);
+    if (!test_bit(map->revealed, index) || test_bit(map->mines, index)) return 0;
+    int need = tile_count(map, index);
+    if (need == 0) return 0;
+
+    // Three neighbours at a time: one row of the 3x3 block around the tile
+    unsigned on_map = (column > 0 ? 1 : 0) | 2 | (column + 1 < map->width ? 4 : 0);
+    uint64_t hidden = 0;
+    for (int i = -1; i <= 1; i ++)
+    {
+        int neighbor_row = row + i;
+        if (neighbor_row < 0 || neighbor_row >= map->height) continue;
+
+        unsigned open = three_bits(map, map->revealed, neighbor_row, column);
+        unsigned marked = three_bits(map, map->flags, neighbor_row, column);
+        need -= __builtin_popcount(marked & ~open);
+        hidden |= (uint64_t)(~open & ~marked & on_map) << WINDOW_BIT(neighbor_row - centre_row, column - 1 - centre_column);
+    }
+
+    constraint->hidden = hidden;
+    constraint->need = need;
+    return hidden != 0;
+}
+
+// List of the numbers whose constraint may have changed since they were last looked at (a
+// number can be in it more than once)
+typedef struct
+{
+    size_t * tiles;
+    size_t count;
+    size_t capacity;
+} Queue;
+
+// What's left to look at, for each of the two rules.  Everything in here is only as big as the
+// numbers that were queued, never the size of the map.
+typedef struct
+{
+    Queue single;
+    Queue pair;
+    Queue batch;        // the tiles being swept (see sweep)
+    MsChanges opened;   // the tiles the last opening flipped (see reveal_tile_changes)
+    int out_of_memory;  // set when a queue couldn't grow
+} Pending;
+
+// Add a tile to the end of a queue
+static void queue_add (Pending * pending, Queue * queue, size_t index)
+{
+    if (queue->count == queue->capacity)
+    {
+        size_t capacity = queue->capacity > 0 ? queue->capacity * 2 : 64;
+        size_t * bigger = realloc(queue->tiles, sizeof(size_t) * capacity);
+        if (bigger == NULL)
+        {
+            pending->out_of_memory = 1;
+            return;
+        }
+        queue->tiles = bigger;
+        queue->capacity = capacity;
+    }
+    queue->tiles[queue->count ++] = index;
+}
+
+// Queue the numbers around a tile that has just been opened or marked
+static void touch_tile (const Board * map, Pending * pending, int row, int column)
+{
+    for (int i = -1; i <= 1; i ++)
+    {
+        int neighbor_row = row + i;
+        if (neighbor_row < 0 || neighbor_row >= map->height) continue;
+
+        for (int j = -1; j <= 1; j ++)
+        {
+            int neighbor_column = column + j;
+            if (neighbor_column < 0 || neighbor_column >= map->width) continue;
+
+            // Only an open number has a constraint
+            size_t neighbor = tile_index(map, neighbor_row, neighbor_column);
+            if (!test_bit(map->revealed, neighbor) || test_bit(map->mines, neighbor) || tile_count(map, neighbor) == 0) continue;
+            queue_add(pending, &pending->single, neighbor);
+            queue_add(pending, &pending->pair, neighbor);
+        }
+    }
+}
+
+// Open (mine = 0) or mark (mine = 1) every tile in a window mask and queue the numbers
+// around them
+// Returns the number of tiles changed, or -1 if it opened a mine or ran out of memory (*result
+// is then set to reveal_tile's result, or -1)
+static int apply_mask (Board * map, long long * score, Pending * pending, int centre_row, int centre_column,
+                       uint64_t mask, int mine, int * result)
+{
+    int changed = 0;
+    for (; mask != 0; mask &= mask - 1)
+    {
+        int bit = __builtin_ctzll(mask);
+        int row = centre_row + bit / WINDOW - 3;
+        int column = centre_column + bit % WINDOW - 3;
+
+        // Another deduction may already have dealt with the tile
+        size_t index = tile_index(map, row, column);
+        if (test_bit(map->revealed, index) || test_bit(map->flags, index)) continue;
+
+        if (mine)
+        {
+            mark_tile(row, column, map);
+        }
+        else
+        {
+            // An opening can reach anywhere, so the engine says which tiles it flipped
+            pending->opened.count = 0;
+            if ((*result = reveal_tile_changes(column, row, score, map, &pending->opened)) != 0) return -1;
+            if (pending->opened.out_of_memory)
+            {
+                *result = -1;
+                return -1;
+            }
+            for (size_t i = 1; i < pending->opened.count; i ++) // the first is (row, column)
+            {
+                int opened_row, opened_column;
+                tile_position(map, pending->opened.tiles[i], &opened_row, &opened_column);
+                touch_tile(map, pending, opened_row, opened_column);
+            }
+        }
+        touch_tile(map, pending, row, column);
+        changed ++;
+    }
+    return changed;
+}
+
+// Single tile rule: decide the hidden neighbours of a number if they are all mines or all safe
+// Returns the number of tiles changed, or -1 (see apply_mask)
+static int single_rule (Board * map, long long * score, Pending * pending, int row, int column, int * result)
+{
+    Constraint c;
+    if (!get_constraint(map, row, column, row, column, &c)) return 0;
+
+    if (c.need == 0) // all mines are marked: the rest are safe
+        return apply_mask(map, score, pending, row, column, c.hidden, 0, result);
+    if (c.need == __builtin_popcountll(c.hidden)) // every hidden neighbour is a mine
+        return apply_mask(map, score, pending, row, column, c.hidden, 1, result);
+    return 0;
+}
+
+// What two constraints with their hidden tiles in the same window prove together
+//   uint64_t * safe, uint64_t * mines: output, the tiles that only one of them touches that
+//                                      must be safe or must be mines
+static void pair_deductions (const Constraint * a, const Constraint * b, uint64_t * safe, uint64_t * mines)
+{
+    *safe = *mines = 0;
+    uint64_t shared = a->hidden & b->hidden;
+    if (shared == 0) return;
+
+    // x of the mines are in the shared tiles; the rest of each number's mines are in
+    // the tiles only it touches
+    uint64_t only_a = a->hidden & ~shared;
+    uint64_t only_b = b->hidden & ~shared;
+    int size_shared = __builtin_popcountll(shared);
+    int size_a = __builtin_popcountll(only_a);
+    int size_b = __builtin_popcountll(only_b);
+    int min_x = 0;
+    if (a->need - size_a > min_x) min_x = a->need - size_a;
+    if (b->need - size_b > min_x) min_x = b->need - size_b;
+    int max_x = size_shared;
+    if (a->need < max_x) max_x = a->need;
+    if (b->need < max_x) max_x = b->need;
+
+    // So the tiles only one of them touches hold between need - max_x and need - min_x mines
+    if (only_a && a->need - min_x == 0) *safe |= only_a;
+    if (only_a && a->need - max_x == size_a) *mines |= only_a;
+    if (only_b && b->need - min_x == 0) *safe |= only_b;
+    if (only_b && b->need - max_x == size_b) *mines |= only_b;
+}
+
+// Pair rule: compare a number with every other number up to two tiles away
+// Returns the number of tiles changed, or -1 (see apply_mask)
+static int pair_rule (Board * map, long long * score, Pending * pending, int row, int column, int * result)
+{
+    Constraint a;
+    if (!get_constraint(map, row, column, row, column, &a)) return 0;
+
+    // Only numbers next to one of this number's hidden tiles can share any with it
+    uint64_t around = a.hidden | a.hidden << 1 | a.hidden >> 1;
+    around |= around << WINDOW | around >> WINDOW;
+    around &= ~((uint64_t)1 << WINDOW_BIT(0, 0));
+
+    int changed = 0;
+    for (; around != 0; around &= around - 1)
+    {
+        int bit = __builtin_ctzll(around);
+        int other_row = row + bit / WINDOW - 3;
+        int other_column = column + bit % WINDOW - 3;
+        if (other_row < 0 || other_row >= map->height || other_column < 0 || other_column >= map->width) continue;
+
+        Constraint b;
+        if (!get_constraint(map, other_row, other_column, row, column, &b)) continue;
+        uint64_t safe, mines;
+        pair_deductions(&a, &b, &safe, &mines);
+        if (safe == 0 && mines == 0) continue;
+
+        int n = apply_mask(map, score, pending, row, column, safe, 0, result);
+        if (n < 0) return -1;
+        changed += n + apply_mask(map, score, pending, row, column, mines, 1, result);
+
+        // This number's constraint has changed, so carry on with the new one
+        if (!get_constraint(map, row, column, row, column, &a)) return changed;
+    }
+    return changed;
+}
+
+// Run a rule on every tile queued for it, taking them off the queue (the tiles it queues while
+// it runs wait for the next sweep).  A number that was queued more than once is just looked at
+// again, which is cheaper than sorting the queue to find them.
+// Returns the number of tiles changed, or -1 (see apply_mask)
+static long long sweep (Board * map, long long * score, Pending * pending, Queue * queue, int pair, int * result)
+{
+    Queue batch = *queue;
+    *queue = pending->batch;
+    queue->count = 0;
+
+    long long changed = 0;
+    for (size_t i = 0; i < batch.count; i ++)
+    {
+        int row, column;
+        tile_position(map, batch.tiles[i], &row, &column);
+        int n = pair ? pair_rule(map, score, pending, row, column, result)
+                     : single_rule(map, score, pending, row, column, result);
+        if (n >= 0 && pending->out_of_memory) n = *result = -1; // a number didn't fit in a queue
+        if (n < 0)
+        {
+            changed = -1;
+            break;
+        }
+        changed += n;
+    }
+    pending->batch = batch;
+    return changed;
+}
+
+int solve_map (Board * map, long long * score)
+{
+    if (map->layout != LAYOUT_ROWS) return -1; // the masks and queues go a row at a time
+    // Only numbers next to a tile that has changed need to be looked at again, so each rule
+    // keeps a queue of them (starting with every open number)
+    Pending pending = { 0 };
+    if (map->frontier != NULL)
+    {
+        // Only the numbers next to the frontier have anything to decide
+        const size_t * tiles;
+        size_t count;
+        if (frontier_tiles(map, &tiles, &count) != 0) return -1;
+        for (size_t i = 0; i < count; i ++)
+        {
+            int row, column;
+            tile_position(map, tiles[i], &row, &column);
+            touch_tile(map, &pending, row, column);
+        }
+    }
+    else
+    {
+        size_t tiles = (size_t)map->width * map->height;
+        size_t words = (tiles + 63) / 64;
+        for (size_t word = 0; word < words; word ++)
+        {
+            for (uint64_t bits = map->revealed[word] & ~map->mines[word]; bits != 0; bits &= bits - 1)
+            {
+                size_t index = word * 64 + __builtin_ctzll(bits);
+                if (index >= tiles || tile_count(map, index) == 0) continue;
+                queue_add(&pending, &pending.single, index);
+                queue_add(&pending, &pending.pair, index);
+            }
+        }
+    }
+
+    int result = pending.out_of_memory ? -1 : 0;
+    while (result == 0)
+    {
+        // The single tile rule is cheap, so run it until it stops finding anything and only
+        // then look at pairs
+        long long changed = sweep(map, score, &pending, &pending.single, 0, &result);
+        if (changed < 0) break;
+        if (changed > 0) continue;
+
+        changed = sweep(map, score, &pending, &pending.pair, 1, &result);
+        if (changed <= 0) break;
+    }
+
+    free(pending.single.tiles);
+    free(pending.pair.tiles);
+    free(pending.batch.tiles);
+    ms_changes_free(&pending.opened);
+    return result;
+}
+
+SolveResult ms_solve (Game * game)
+{
+    if (game->status == MS_WON) return SOLVE_WON;
+    if (game->status == MS_LOST) return SOLVE_LOST;
+
+    // The solver opens and marks tiles straight on the map, not as moves, so they can't be undone
+    ms_history_clear(game);
+    long long old_score = game->score;
+    int result = solve_map(&game->map, &game->score);
+
+    // Each overturned tile adds one to the score
+    game->free_positions -= game->score - old_score;
+    if (result == 1)
+    {
+        game->status = MS_LOST;
+        return SOLVE_LOST;
+    }
+    if (game->free_positions <= 0)
+    {
+        game->status = MS_WON;
+        return SOLVE_WON;
+    }
+    return result < 0 ? SOLVE_NO_MEMORY : SOLVE_GUESS;
+}
+
+// Current CLOCK_MONOTONIC time in seconds
+static double now_seconds (void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Point the hint at a tile (forgetting the number it came from)
+static void hint_tile (Hint * hint, HintKind kind, int row, int column, double chance)
+{
+    hint->kind = kind;
+    hint->number_row = hint->number_column = -1;
+    hint->row = row;
+    hint->column = column;
+    hint->chance = chance;
+}
+
+// Point the hint at the tile of the lowest bit of a window mask
+static void hint_window (Hint * hint, HintKind kind, uint64_t mask, int centre_row, int centre_column, double chance)
+{
+    int bit = __builtin_ctzll(mask);
+    hint_tile(hint, kind, centre_row + bit / WINDOW - 3, centre_column + bit % WINDOW - 3, chance);
+}
+
+// Look for a safe tile around the number at (row, column) with the single tile rule (pair = 0)
+// or the pair rule (pair = 1).  The single tile rule also keeps the hidden tile whose number
+// leaves it the least likely to be a mine in the hint, as a HINT_GUESS from that number.
+// Returns 1 if it found one (or a number with too many marks), otherwise 0
+static int hint_number (const Board * map, int row, int column, int pair, Hint * hint)
+{
+    Constraint a;
+    if (!get_constraint(map, row, column, row, column, &a)) return 0;
+
+    if (!pair)
+    {
+        double risk = (double)a.need / __builtin_popcountll(a.hidden);
+        if (a.need < 0)
+            hint_tile(hint, HINT_WRONG_MARKS, -1, -1, 0);
+        else if (a.need == 0)
+            hint_window(hint, HINT_SINGLE, a.hidden, row, column, 0);
+        else if (hint->kind == HINT_NONE || risk < hint->chance)
+            hint_window(hint, HINT_GUESS, a.hidden, row, column, risk);
+        else
+            return 0;
+        hint->number_row = row;
+        hint->number_column = column;
+        return a.need <= 0;
+    }
+
+    // Same numbers as pair_rule
+    uint64_t around = a.hidden | a.hidden << 1 | a.hidden >> 1;
+    around |= around << WINDOW | around >> WINDOW;
+    around &= ~((uint64_t)1 << WINDOW_BIT(0, 0));
+    for (; around != 0; around &= around - 1)
+    {
+        int bit = __builtin_ctzll(around);
+        int other_row = row + bit / WINDOW - 3;
+        int other_column = column + bit % WINDOW - 3;
+        if (other_row < 0 || other_row >= map->height || other_column < 0 || other_column >= map->width) continue;
+
+        Constraint b;
+        if (!get_constraint(map, other_row, other_column, row, column, &b)) continue;
+        uint64_t safe, mines;
+        pair_deductions(&a, &b, &safe, &mines);
+        if (safe == 0) continue;
+
+        hint_window(hint, HINT_PAIR, safe, row, column, 0);
+        hint->number_row = row;
+        hint->number_column = column;
+        hint->other_row = other_row;
+        hint->other_column = other_column;
+        return 1;
+    }
+    return 0;
+}
+
+// Run hint_number on every number next to the frontier, or on every open tile if the frontier
+// isn't tracked
+//   uint64_t * seen: one bit per tile, all 0, to look at each number next to the frontier once
+//                    (or NULL to look at every open tile instead)
+// Returns 1 if it found a safe tile (or a number with too many marks), 0 if not, or -1 if the
+// deadline passed first
+static int hint_sweep (const Board * map, int pair, uint64_t * seen, double deadline, Hint * hint)
+{
+    int width = map->width;
+    const size_t * frontier;
+    size_t count;
+    if (map->frontier != NULL && seen != NULL && frontier_tiles(map, &frontier, &count) == 0)
+    {
+        for (size_t i = 0; i < count; i ++)
+        {
+            if (i % 64 == 0 && now_seconds() >= deadline) return -1;
+            int row = frontier[i] / width;
+            int column = frontier[i] % width;
+            for (int j = row - 1; j <= row + 1; j ++)
+            {
+                for (int k = column - 1; k <= column + 1; k ++)
+                {
+                    if (j < 0 || j >= map->height || k < 0 || k >= width) continue;
+                    size_t index = tile_index(map, j, k);
+                    if (!test_bit(map->revealed, index) || test_bit(seen, index)) continue;
+                    set_bit(seen, index);
+                    if (hint_number(map, j, k, pair, hint)) return 1;
+                }
+            }
+        }
+        return 0;
+    }
+
+    size_t tiles = (size_t)width * map->height;
+    size_t words = (tiles + 63) / 64;
+    for (size_t word = 0; word < words; word ++)
+    {
+        if (map->revealed[word] == 0) continue;
+        if (now_seconds() >= deadline) return -1;
+        for (uint64_t bits = map->revealed[word]; bits != 0; bits &= bits - 1)
+        {
+            size_t index = word * 64 + __builtin_ctzll(bits);
+            if (index >= tiles) break;
+            if (hint_number(map, index / width, index % width, pair, hint)) return 1;
+        }
+    }
+    return 0;
+}
+
+// A hidden, unmarked tile with no open tile around it, which no number says anything about
+// Returns its index, or -1 if there isn't one or the deadline passed before one was found
+static long long lone_tile (const Board * map, double deadline)
+{
+    int width = map->width;
+    int height = map->height;
+    size_t tiles = (size_t)width * height;
+    size_t words = (tiles + 63) / 64;
+    for (size_t word = 0; word < words; word ++)
+    {
+        if (word % 64 == 0 && now_seconds() >= deadline) return -1;
+        for (uint64_t bits = ~(map->revealed[word] | map->flags[word]); bits != 0; bits &= bits - 1)
+        {
+            size_t index = word * 64 + __builtin_ctzll(bits);
+            if (index >= tiles) break;
+            int row = index / width;
+            int column = index % width;
+            int open = 0;
+            for (int i = row - 1; i <= row + 1 && !open; i ++)
+                for (int j = column - 1; j <= column + 1 && !open; j ++)
+                    open = i >= 0 && i < height && j >= 0 && j < width && test_bit(map->revealed, tile_index(map, i, j));
+            if (!open) return index;
+        }
+    }
+    return -1;
+}
+
+void ms_hint (const Game * game, double milliseconds, Hint * hint)
+{
+    double deadline = now_seconds() + milliseconds / 1e3;
+    const Board * map = &game->map;
+    int width = map->width;
+    size_t tiles = (size_t)width * map->height;
+    size_t words = (tiles + 63) / 64;
+    hint_tile(hint, HINT_NONE, -1, -1, 0);
+    hint->other_row = hint->other_column = -1;
+    hint->exact = 0;
+    hint->out_of_time = 0;
+    if (game->status != MS_PLAYING || map->layout != LAYOUT_ROWS) return;
+
+    // A game that's still being played has a free tile left, so if there's no room for the mines
+    // (or for that tile) a mark is wrong
+    long long hidden, marked;
+    count_hidden(map, &hidden, &marked);
+    long long mines_left = game->num_mines - marked;
+    if (hidden == 0 || mines_left < 0 || mines_left >= hidden)
+    {
+        hint_tile(hint, HINT_WRONG_MARKS, -1, -1, 0);
+        return;
+    }
+
+    // 1 and 2. Single numbers first, then pairs.  Only the parts of the seen planes next to the
+    // frontier are ever touched, so on a big map most of them are never even paged in.
+    uint64_t * seen = map->frontier != NULL ? calloc(words * 2, sizeof(uint64_t)) : NULL;
+    int found = 0;
+    for (int pair = 0; pair <= 1 && found == 0; pair ++)
+        found = hint_sweep(map, pair, seen != NULL ? seen + pair * words : NULL, deadline, hint);
+    free(seen);
+    if (found > 0) return;
+    hint->out_of_time = found < 0;
+
+    // 3. The exact chances, if there's time
+    if (!hint->out_of_time && tiles <= HINT_EXACT_TILES)
+    {
+        double * probability = malloc(sizeof(double) * tiles);
+        int result = probability == NULL ? -1 : mine_probabilities_until(map, game->num_mines, probability, deadline);
+        if (result == 0)
+        {
+            size_t best = tiles;
+            for (size_t index = 0; index < tiles; index ++)
+            {
+                if (test_bit(map->revealed, index) || test_bit(map->flags, index)) continue;
+                if (best == tiles || probability[index] < probability[best]) best = index;
+            }
+            hint_tile(hint, probability[best] <= 0 ? HINT_COUNTED : HINT_GUESS, best / width, best % width, probability[best]);
+            hint->exact = 1;
+        }
+        else if (result == 1)
+            hint_tile(hint, HINT_WRONG_MARKS, -1, -1, 0);
+        hint->out_of_time = result == 2;
+        free(probability);
+        if (result == 0 || result == 1) return;
+    }
+
+    // Otherwise the best estimate: a tile no number says anything about has about the average
+    // chance, which may be lower than the best one next to a number
+    double average = (double)mines_left / hidden;
+    if (hint->kind == HINT_NONE || average < hint->chance)
+    {
+        long long index = lone_tile(map, deadline);
+        if (index >= 0)
+            hint_tile(hint, HINT_GUESS, index / width, index % width, average);
+        else if (hint->kind == HINT_NONE)
+        {
+            // Out of time with nothing to go on: any hidden tile will do
+            for (size_t word = 0; index < 0; word ++)
+                if ((~(map->revealed[word] | map->flags[word])) != 0)
+                    index = word * 64 + __builtin_ctzll(~(map->revealed[word] | map->flags[word]));
+            hint_tile(hint, HINT_GUESS, index / width, index % width, average);
+        }
+    }
+}
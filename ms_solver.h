@@ -0,0 +1,127 @@
+// Deterministic Minesweeper solver
+// Plays a game using only what a player can see (the open tiles, their counts and the marks)
+// and never looks at the mines plane.  Safe tiles are opened with reveal_tile and certain
+// mines are marked with mark_tile, so the board it leaves behind is an ordinary one.
+#ifndef MS_SOLVER_H
+#define MS_SOLVER_H
+#include "ms_engine.h"
+
+// Result of running the solver on a game
+typedef enum
+{
+    SOLVE_WON = 0,      // every free tile has been opened
+    SOLVE_GUESS,        // nothing else can be proven safe or a mine: a guess is unavoidable
+    SOLVE_LOST,         // a mine was opened (only possible if a marked tile wasn't really a mine)
+    SOLVE_NO_MEMORY     // ran out of memory part way through
+} SolveResult;
+
+// ms_solve -> SolveResult
+//   Game * game: game with at least one tile already open (e.g. the first click)
+// Opens every tile that can be proven safe and marks every tile that can be proven to be a
+// mine, then reports whether the game was won or a guess is needed.  Updates the score, the
+// number of free positions and the status of the game like ms_reveal.
+// Assumes every marked tile really is a mine (true when only the solver has marked tiles).
+// Forgets the game's undo history (see ms_history_start), since what it does isn't kept there.
+SolveResult ms_solve (Game * game);
+
+// solve_map -> int
+//   Board * map: map with at least one tile open
+//   long long * score: pointer to score variable (one is added for every tile opened)
+// Repeatedly applies these deductions until none of them find anything new:
+//      * single tile: a number whose hidden neighbours are all mines, or that already has
+//        all of its mines marked, decides all of its hidden neighbours
+//      * pairs: two numbers up to two tiles apart that share hidden neighbours limit how many
+//        mines the shared tiles can hold, which can decide the tiles that only one of them
+//        touches (this covers subsets and the classic 1-1 and 1-2 patterns)
+// If the map's frontier is tracked (see frontier_track), it starts from the numbers next to the
+// frontier instead of every open tile, so it takes time in proportion to the frontier and the
+// tiles it decides, not to the size of the map.
+// Returns 0 when nothing more can be deduced, 1 if it opened a mine (see ms_solve) or -1 if
+// it ran out of memory or the map isn't LAYOUT_ROWS.
+int solve_map (Board * map, long long * score);
+
+// mine_probabilities -> int
+//   const Board * map
+//   long long num_mines: number of mines on the whole map
+//   double * probability: output, one per tile (width * height)
+// Works out the exact chance of each hidden tile being a mine, given the open numbers, the
+// marks and the number of mines, assuming every consistent arrangement of the mines is equally
+// likely.  Open tiles get 0 and marked tiles 1 (marks are taken to be right, like ms_solve).
+// Hidden tiles next to the numbers are split into independent components that are each
+// enumerated exactly (see ms_probability.c); all other hidden tiles share one probability.
+// If the map's frontier is tracked (see frontier_track), only the numbers next to it are
+// looked at instead of every open tile (a chance is still written for every tile).
+// Returns 0, 1 if no arrangement of the mines fits the board (e.g. a wrong mark), or -1 if
+// it ran out of memory or the map isn't LAYOUT_ROWS.
+int mine_probabilities (const Board * map, long long num_mines, double * probability);
+
+// mine_probabilities_until -> int
+//   const Board * map, long long num_mines, double * probability: see mine_probabilities
+//   double deadline: CLOCK_MONOTONIC time (in seconds) to give up at, or 0 to never give up
+// Like mine_probabilities, but stops enumerating once the deadline has passed
+// Returns 0, 1 or -1 like mine_probabilities, or 2 if it ran out of time (probability is then
+// left half filled in)
+int mine_probabilities_until (const Board * map, long long num_mines, double * probability, double deadline);
+
+// What a hint is based on
+typedef enum
+{
+    HINT_NONE = 0,      // no hidden, unmarked tile is left (or the game is over)
+    HINT_SINGLE,        // safe: the number already has all of its mines marked around it
+    HINT_PAIR,          // safe: the number and another one up to two tiles away share hidden
+                        //   tiles, and between them leave no room for a mine on this one
+    HINT_COUNTED,       // safe: no arrangement of the mines that fits every number puts one here
+    HINT_GUESS,         // nothing was proven safe, this is the tile least likely to be a mine
+    HINT_WRONG_MARKS    // no arrangement of the mines fits the map, so a mark must be wrong (the
+                        //   number, if any, has more marks around it than its count)
+} HintKind;
+
+// A tile to open next and why
+typedef struct
+{
+    HintKind kind;
+    int row, column;                // the tile (start at 0), or -1 for HINT_NONE and HINT_WRONG_MARKS
+    int number_row, number_column;  // the number that proves it (HINT_SINGLE, HINT_PAIR), that
+                                    //   a HINT_GUESS estimate comes from, or that has too many
+                                    //   marks (HINT_WRONG_MARKS), or -1 if there isn't one
+    int other_row, other_column;    // the other number of HINT_PAIR, or -1
+    double chance;                  // chance of a mine there (0 when it's proven safe)
+    int exact;                      // whether chance is exact (from mine_probabilities) or only
+                                    //   a rough estimate from the numbers around the tile
+    int out_of_time;                // whether the time ran out before every deduction was tried
+} Hint;
+
+// Tiles above which a hint doesn't try mine_probabilities (just filling in the chances of every
+// tile would take up most of the time)
+#define HINT_EXACT_TILES (1 << 20)
+
+// ms_hint
+//   const Game * game
+//   double milliseconds: how long it may take
+//   Hint * hint: output
+// Finds a tile to open next, trying the cheapest deductions first and going on to deeper ones
+// only while there's time left:
+//      1. a number that has all of its mines marked (HINT_SINGLE)
+//      2. two numbers together (HINT_PAIR, the same pairs as solve_map)
+//      3. the exact chances (HINT_COUNTED if one is 0, otherwise HINT_GUESS with the lowest)
+// If the time runs out first it gives the best tile found so far: the one whose numbers leave it
+// the least likely to be a mine (a rough estimate).  Like ms_solve, marks are taken to be right.
+// The game isn't changed.  If the map's frontier is tracked (see frontier_track), only the
+// numbers next to it are looked at, which keeps hints fast on big maps.
+void ms_hint (const Game * game, double milliseconds, Hint * hint);
+
+// Most candidate maps ms_new_no_guess tries before giving up
+#define NO_GUESS_ATTEMPTS 100000
+
+// ms_new_no_guess -> Game *
+//   int width, int height, long long num_mines, uint64_t seed: see ms_new
+//   int row, int column: the first move (both start at 0)
+//   int threads: number of threads to search with (0 = one per core)
+// Makes a game that the solver can win from the first move without ever guessing, and makes
+// the first move (see ms_new_at).  Candidate maps are generated and solved on all threads at
+// once; the same seed always gives the same map, whatever the number of threads.
+// Returns NULL if the arguments are invalid, if none of the first NO_GUESS_ATTEMPTS candidates
+// can be won without guessing (e.g. too many mines), or if it runs out of memory.
+Game * ms_new_no_guess (int width, int height, long long num_mines, uint64_t seed, int row, int column, int threads);
+
+#endif
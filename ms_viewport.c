@@ -0,0 +1,209 @@
+// Scrolling curses view of the map (see ms_viewport.h)
+//
+// The screen is laid out as
+//      line 0:     score, tiles left and the position of the cursor
+//      line 1:     column numbers (every tenth column)
+//      the rest:   the row number and then 2 characters per tile
+// Every frame is drawn from scratch into curses' window, and curses works out what actually
+// changed on the terminal.
+#include <stdio.h>
+#include <curses.h>
+#include "ms_viewport.h"
+
+// Characters taken by the row numbers on the left
+#define ROW_NUMBERS 7
+
+// Where the view is
+typedef struct
+{
+    int top;                // first row and column shown (both start at 0)
+    int left;
+    int rows;               // number of rows and columns that fit on the screen
+    int columns;
+    int cursor_row;         // tile under the cursor
+    int cursor_column;
+    int last_row;           // last tile opened
+    int last_column;
+} Viewport;
+
+// Keep a position between 0 and limit - 1
+static int clamp (int value, int limit)
+{
+    if (value >= limit) value = limit - 1;
+    if (value < 0) value = 0;
+    return value;
+}
+
+// Fit the view to the terminal and scroll it as little as possible to show the cursor
+static void follow_cursor (Viewport * view, const Game * game)
+{
+    int lines, characters;
+    getmaxyx(stdscr, lines, characters);
+    view->rows = lines - 2 > 1 ? lines - 2 : 1;
+    view->columns = (characters - ROW_NUMBERS) / 2 > 1 ? (characters - ROW_NUMBERS) / 2 : 1;
+
+    view->cursor_row = clamp(view->cursor_row, game->height);
+    view->cursor_column = clamp(view->cursor_column, game->width);
+    if (view->cursor_row < view->top) view->top = view->cursor_row;
+    if (view->cursor_row >= view->top + view->rows) view->top = view->cursor_row - view->rows + 1;
+    if (view->cursor_column < view->left) view->left = view->cursor_column;
+    if (view->cursor_column >= view->left + view->columns) view->left = view->cursor_column - view->columns + 1;
+}
+
+// Put a tile in the middle of the view
+static void centre_on (Viewport * view, const Game * game, int row, int column)
+{
+    view->cursor_row = row;
+    view->cursor_column = column;
+    follow_cursor(view, game);
+    view->top = clamp(row - view->rows / 2, game->height);
+    view->left = clamp(column - view->columns / 2, game->width);
+}
+
+// Character a tile is shown as (the same as draw_tile in Minesweeper.c)
+static char tile_glyph (const Board * map, int row, int column)
+{
+    size_t index = tile_index(map, row, column);
+    if (test_bit(map->flags, index)) // Hidden Tile Marked as Potential Mine
+        return '?';
+    if (!test_bit(map->revealed, index)) // Hidden Tile
+        return '.';
+    if (test_bit(map->mines, index)) // Revealed Mines
+        return '#';
+    int count = tile_count(map, index);
+    return count > 0 ? '0' + count : ' ';
+}
+
+// Draw the visible part of the map
+static void draw_view (const Viewport * view, const Game * game, const char * message)
+{
+    erase();
+    mvprintw(0, 0, "Score: %lld   Left: %lld   Row %d, Column %d   %s", game->score, game->free_positions,
+             view->cursor_row + 1, view->cursor_column + 1, message);
+
+    // Column numbers over every tenth column (and the first one)
+    for (int column = view->left; column < view->left + view->columns && column < game->width; column ++)
+        if (column == view->left || (column + 1) % 10 == 0)
+            mvprintw(1, ROW_NUMBERS + 2 * (column - view->left), "C%d", column + 1);
+
+    for (int row = view->top; row < view->top + view->rows && row < game->height; row ++)
+    {
+        int line = 2 + row - view->top;
+        mvprintw(line, 0, "R%d", row + 1);
+        move(line, ROW_NUMBERS);
+        for (int column = view->left; column < view->left + view->columns && column < game->width; column ++)
+        {
+            char glyph = tile_glyph(&game->map, row, column);
+            if (row == view->cursor_row && column == view->cursor_column)
+            {
+                attron(A_REVERSE);
+                addch(glyph);
+                attroff(A_REVERSE);
+                addch(' ');
+            }
+            else
+            {
+                addch(glyph);
+                addch(' ');
+            }
+        }
+    }
+    refresh();
+}
+
+int viewport_play (Game * game)
+{
+    if (initscr() == NULL) return -1;
+    cbreak();
+    noecho();
+    keypad(stdscr, TRUE);
+    curs_set(0);
+
+    Viewport view = { 0 };
+    view.last_row = game->height / 2;
+    view.last_column = game->width / 2;
+    centre_on(&view, game, view.last_row, view.last_column);
+
+    const char * message = "(arrows move, space opens, m marks, u undoes, r redoes, c goes back, q quits)";
+    while (ms_status(game) == MS_PLAYING)
+    {
+        follow_cursor(&view, game);
+        draw_view(&view, game, message);
+        message = "";
+
+        int key = getch();
+        if (key == 'q' || key == ERR)
+            break;
+        else if (key == KEY_UP || key == 'k')
+            view.cursor_row --;
+        else if (key == KEY_DOWN || key == 'j')
+            view.cursor_row ++;
+        else if (key == KEY_LEFT || key == 'h')
+            view.cursor_column --;
+        else if (key == KEY_RIGHT || key == 'l')
+            view.cursor_column ++;
+        else if (key == KEY_PPAGE || key == 'K')
+        {
+            view.top = clamp(view.top - view.rows, game->height);
+            view.cursor_row -= view.rows;
+        }
+        else if (key == KEY_NPAGE || key == 'J')
+        {
+            view.top = clamp(view.top + view.rows, game->height);
+            view.cursor_row += view.rows;
+        }
+        else if (key == 'H')
+        {
+            view.left = clamp(view.left - view.columns, game->width);
+            view.cursor_column -= view.columns;
+        }
+        else if (key == 'L')
+        {
+            view.left = clamp(view.left + view.columns, game->width);
+            view.cursor_column += view.columns;
+        }
+        else if (key == 'c')
+            centre_on(&view, game, view.last_row, view.last_column);
+        else if (key == 'u' || key == 'r')
+        {
+            if ((key == 'u' ? ms_undo(game) : ms_redo(game)) == MS_NO_CHANGE)
+                message = key == 'u' ? "There's no move left to undo" : "There's no move to redo";
+        }
+        else if (key == 'm')
+        {
+            if (ms_mark(game, view.cursor_row, view.cursor_column) == MS_NO_CHANGE)
+                message = "That tile is already open";
+        }
+        else if (key == ' ' || key == 'g')
+        {
+            // Opening a tile that is already open chords around it instead
+            MsResult result = ms_reveal(game, view.cursor_row, view.cursor_column);
+            if (result == MS_NO_CHANGE) result = ms_chord(game, view.cursor_row, view.cursor_column);
+            if (result == MS_NO_CHANGE)
+                message = "That tile is already open";
+            else if (result == MS_NO_MEMORY)
+                message = "Not enough memory to open all of it";
+            view.last_row = view.cursor_row;
+            view.last_column = view.cursor_column;
+
+            // A lost move can still be taken back, before the mines are shown
+            if (result == MS_MINE && game->history != NULL && game->history->undos > 0)
+            {
+                draw_view(&view, game, "KABOOM!!!! (u takes the move back, any other key shows the mines)");
+                if (getch() == 'u') ms_undo(game);
+            }
+        }
+    }
+
+    // Show where the mines were
+    if (ms_status(game) != MS_PLAYING)
+    {
+        if (ms_status(game) == MS_LOST) reveal_map(&game->map);
+        follow_cursor(&view, game);
+        draw_view(&view, game, ms_status(game) == MS_WON ? "YOU WIN!!! (press any key)" : "KABOOM!!!! (press any key)");
+        getch();
+    }
+
+    endwin();
+    return 0;
+}
@@ -0,0 +1,26 @@
+// Scrolling curses view of the map
+// Only the part of the map that fits in the terminal is drawn, so a frame costs the same on a
+// 10000 x 10000 map as on a 30 x 16 one.  A cursor picks the tile to open or mark, and the view
+// scrolls to follow it.
+#ifndef MS_VIEWPORT_H
+#define MS_VIEWPORT_H
+#include "ms_engine.h"
+
+// viewport_play -> int
+//   Game * game: the game to play (it may already have tiles open)
+// Plays the game in a full screen curses window until it is won or lost, or the player quits.
+// The keys are:
+//      arrow keys / h j k l    move the cursor one tile
+//      H J K L / page keys     scroll a whole screen
+//      space or g              open the tile under the cursor (on an open number whose mines are
+//                              all marked, open everything around it: see ms_chord)
+//      m                       mark / unmark the tile under the cursor
+//      u / r                   undo / redo a move (if the game keeps a history: see ms_undo)
+//      c                       jump back to the last tile opened
+//      q                       quit
+// A move that steps on a mine can be taken back with u (if the game keeps a history).  Once the
+// game is over the mines are shown until a key is pressed.
+// Returns 0, or -1 if the terminal couldn't be set up for curses.
+int viewport_play (Game * game);
+
+#endif
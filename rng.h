@@ -0,0 +1,88 @@
+// Small, fast, seedable random number generator (xoshiro256**)
+// Each game carries its own Rng, so a seed always gives the same sequence no matter what else
+// is running, and games on different threads never share state (unlike rand()).
+#ifndef RNG_H
+#define RNG_H
+#include <stdint.h>
+#include <time.h>
+
+typedef struct
+{
+    uint64_t state[4];
+} Rng;
+
+// rng_splitmix64 -> uint64_t
+//   uint64_t * x: state to advance
+// Scrambles a counter into well mixed 64-bit values (used to turn a seed into the generator state)
+static inline uint64_t rng_splitmix64 (uint64_t * x)
+{
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// rng_seed
+//   Rng * rng: generator to set up
+//   uint64_t seed: any value (the same seed always gives the same numbers)
+static inline void rng_seed (Rng * rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i ++)
+        rng->state[i] = rng_splitmix64(&seed);
+}
+
+// rng_next -> uint64_t
+//   Rng * rng
+// Returns 64 random bits
+static inline uint64_t rng_next (Rng * rng)
+{
+    uint64_t * s = rng->state;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+
+    return result;
+}
+
+// rng_below -> uint64_t
+//   Rng * rng
+//   uint64_t n: number of possible results (must be at least 1)
+// Returns a uniformly random number from 0 to n - 1 with no modulo bias
+static inline uint64_t rng_below (Rng * rng, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    // Lemire's method: the top half of a 64x64-bit product, redrawing the rare low halves
+    // that would make some results more likely than others
+    unsigned __int128 product = (unsigned __int128)rng_next(rng) * n;
+    if ((uint64_t)product < n)
+    {
+        uint64_t threshold = -n % n;
+        while ((uint64_t)product < threshold)
+            product = (unsigned __int128)rng_next(rng) * n;
+    }
+    return product >> 64;
+#else
+    // Redraw anything in the incomplete block at the bottom of the range
+    uint64_t threshold = -n % n;
+    uint64_t bits;
+    do bits = rng_next(rng); while (bits < threshold);
+    return bits % n;
+#endif
+}
+
+// rng_time_seed -> uint64_t
+// Returns a seed that is different every time the program runs (for when no seed was given)
+static inline uint64_t rng_time_seed (void)
+{
+    uint64_t x = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32) ^ (uint64_t)(uintptr_t)&x;
+    return rng_splitmix64(&x);
+}
+
+#endif